@@ -10,62 +10,48 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
 
 //sfml
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 
+#include "Source/textures.h"
+#include "Source/audio.h"
+#include "Source/map.h"
+#include "Source/recorder.h"
+#include "Source/history.h"
+#include "Source/metrics.h"
+#include "Source/tiles.h"
+#include "Source/render.h"
+
 #define DEBUG_MODE 0
 
 using namespace sf;
 
 RenderWindow window(sf::VideoMode(450, 800), "Minesweeper");
-Font font;
-
-namespace alone {
-    /**
-     * контейнер для управления текстурками
-     */
-    class TextureManager {
-    public:
-        /**
-         * подгрузка текстурок из конфига
-         * @param config_name
-         */
-        void load(std::string config_name) {
-            std::ifstream file(config_name);
 
-            while (!file.eof()) {
-                std::string temp;
-                file >> temp;
-                /**
-                 * загружается только из этой папки, но сам файл может быть с кастомным именем
-                 */
-                sf::Texture texture;
-                texture.loadFromFile("assets/textures/" + temp);
-                /**
-                 * Вставка в контейнер
-                 */
-                _Content.emplace(temp, std::move(texture));
-            }
-        }
+/**
+ *  все ресурсы игры в одном файле, шрифт и музыка читают прямо из него
+    поэтому бандл объявлен раньше них и разрушается позже
+ */
+alone::Bundle assets;
+Font font;
 
-        /**
-         * перегрузка оператора индексирования для более красивого кода
-         * @param key
-         * @return
-         */
-        sf::Texture &operator[](std::string key) {
-            return _Content.at(key);
-        }
+/**
+ * звуки и музыка, тоже читают из бандла
+ */
+alone::Audio audio;
 
-    private:
-        /**
-         * unordered_map работае быстрее обычной map
-         */
-        std::unordered_map<std::string, sf::Texture> _Content;
-    };
+/**
+ * запись игры в файл, включается ключом --record
+ */
+alone::Recorder recorder;
 
+namespace alone {
     /**
      *  базовое состояние игры, от него насследуются все остальные
 	    отвечает за всё в своём процессе
@@ -100,15 +86,41 @@ namespace alone {
          */
         virtual void onDelete() = 0;
 
+        /**
+         *  команды кадра в общую очередь отрисовки
+            по умолчанию состояние рисуется целиком через свой draw в слое интерфейса
+         */
+        virtual void submit(RenderQueue &queue) const {
+            queue.submit(RenderQueue::Interface, *this);
+        }
+
+        /**
+         *  размер экрана состояния в его собственных координатах
+            окно своего размера не меняет, экран вписывается в него с сохранением пропорций и полосами по краям
+         */
+        virtual sf::Vector2f resolution() const {
+            return sf::Vector2f(450, 800);
+        }
+
     private:
         Status _Status;
+
+        /**
+         * номер вставки в машину состояний, в этом порядке состояния рисуются
+         */
+        size_t _Order = 0;
     };
 
+    namespace input {
+        extern sf::Vector2i mouse, pixel;
+    }
+
     /**
      * Машина состояний, являющаяся контейнром состояний и их инвокером
 	    Также отвечает за отрисовку
+	    сама тоже Drawable, чтобы ту же сцену можно было нарисовать ещё и в запись
      */
-    class StateMachine {
+    class StateMachine : public sf::Drawable {
     public:
         /**
          * Вставка нового состояния с определённым ключом и заранее созданым состоянием
@@ -118,6 +130,7 @@ namespace alone {
          */
         void insert(std::string key, std::shared_ptr<State> value) {
             value->_Status = State::OnCreate;
+            value->_Order = _Inserted++;
             _Content.emplace(key, value);
         }
 
@@ -148,10 +161,13 @@ namespace alone {
                          * основной статус, в котором проводит время состояние игры
                          *
                          */
-                    case State::Active:
+                    case State::Active: {
+                        //мышь переводится в координаты состояния, как будто окно всегда его размера
+                        auto point = window.mapPixelToCoords(input::pixel, letterbox(it.second->resolution(), window.getSize()));
+                        input::mouse = sf::Vector2i(std::floor(point.x), std::floor(point.y));
                         it.second->update();
-                        it.second->draw(window, sf::RenderStates::Default);
                         break;
+                    }
                     case State::OnDelete:
                         it.second->onDelete();
                         onRemove.push(it.first);
@@ -166,10 +182,64 @@ namespace alone {
                 _Content.erase(onRemove.front());
                 onRemove.pop();
             }
+
+            draw(window);
+        }
+
+        /**
+         *  отрисовка всех активных состояний, без обновления: в окно из update и в запись
+            все состояния кладут команды в одну очередь, порядок задают слои, а не порядок в контейнере,
+            а одинаковые текстуры рисуются одним вызовом
+            у каждого состояния свой вид, поэтому очередь рисуется, когда меняется размер экрана состояния
+            порядок обхода unordered_map не определён, поэтому состояния идут по порядку вставки:
+            вставленное позже рисуется поверх
+         * @param target
+         * @param states
+         */
+        void draw(sf::RenderTarget &target, sf::RenderStates states = sf::RenderStates::Default) const override {
+            _Active.clear();
+            for (auto &it: _Content)
+                if (it.second->_Status == State::Active)
+                    _Active.push_back(it.second.get());
+            std::sort(_Active.begin(), _Active.end(), [](const State *lhs, const State *rhs) { return lhs->_Order < rhs->_Order; });
+
+            auto saved = target.getView();
+            sf::Vector2f resolution;
+            bool pending = false;
+            auto flush = [&]() {
+                target.setView(letterbox(resolution, target.getSize()));
+                _Queue.flush(target, states);
+            };
+
+            for (auto it: _Active) {
+                if (pending && it->resolution() != resolution)
+                    flush();
+                resolution = it->resolution();
+                pending = true;
+                it->submit(_Queue);
+            }
+            if (pending)
+                flush();
+            target.setView(saved);
         }
 
     private:
         std::unordered_map<std::string, std::shared_ptr<State>> _Content;
+
+        /**
+         * сколько состояний вставлено, отсюда берётся номер следующего
+         */
+        size_t _Inserted = 0;
+
+        /**
+         * активные состояния кадра по порядку вставки, память переиспользуется между кадрами
+         */
+        mutable std::vector<const State *> _Active;
+
+        /**
+         * очередь отрисовки, память переиспользуется между кадрами
+         */
+        mutable RenderQueue _Queue;
     };
 }
 
@@ -186,101 +256,112 @@ namespace alone::input {
     bool preRmb = false, nowRmb = false;
 
     /**
-     *  pre - состояние нажатия во время прошлого обнолвения
-	    now - во время текущего
-
-	    обновляет текущее состояие нажатия обеих клавиш
+     * и для средней, ей делается аккорд
      */
-
-    void update() {
-        preLmb = nowLmb;
-        preRmb = nowRmb;
-        nowLmb = sf::Mouse::isButtonPressed(sf::Mouse::Left);
-        nowRmb = sf::Mouse::isButtonPressed(sf::Mouse::Right);
-    }
+    bool preMmb = false, nowMmb = false;
 
     /**
-     *  запрос состояния нажатия левой кнопки мыши
-	    выдаёт true только если кнопка была только что поднята
-     * @return
+     * клавиши отмены и повтора хода, Z и Y
      */
-    bool isClickedLeftButton() {
-        return preLmb && !nowLmb;
-    }
+    bool preUndo = false, nowUndo = false;
+    bool preRedo = false, nowRedo = false;
 
     /**
-     * то же самое, но для правой
-     * @return
+     * левая и правая кнопки были зажаты вместе с тех пор, как все кнопки последний раз были отпущены
      */
-    bool isClickedRightButton() {
-        return preRmb && !nowRmb;
-    }
-}
+    bool both = false;
 
-/**
- * упрощение нейминга
- */
-template<class _T>
-using Matrix = std::vector<std::vector<_T>>;
-
-
-/**
- * это для удобной нумерации текстурок
- */
-enum class Type {
     /**
-     * кол-во бомб от 1 до 8
+     *  положение мыши на текущем обновлении в координатах обновляемого состояния
+        состояния читают его отсюда, а не у sf::Mouse, чтобы нажатия можно было подставить без окна
      */
-    Number1 = 0,
-    Number2 = 1,
-    Number3,
-    Number4,
-    Number5,
-    Number6,
-    Number7,
-    Number8,
+    sf::Vector2i mouse;
 
     /**
-     * бомб нет
+     * положение мыши в пикселях окна, из него машина состояний считает mouse
      */
-    None,
+    sf::Vector2i pixel;
 
     /**
-     * неизвестно что тут
-     */
-    Unknown,
+     *  pre - состояние нажатия во время прошлого обнолвения
+	    now - во время текущего
 
-    /**
-     * флажок, если бомба тут есть
+	    обновляет текущее состояие нажатия обеих клавиш
      */
-    Flag,
 
     /**
-     * бомбы нет
+     *  переход кнопок мыши к новому состоянию: текущее становится прошлым
+        update берёт новое состояние у sf::Mouse, а без окна его можно подставить напрямую
+     * @param left
+     * @param right
+     * @param middle
      */
-    NoBomb,
+    void press(bool left, bool right, bool middle = false) {
+        //все кнопки были отпущены - аккорд обеими кнопками закончился
+        if (!nowLmb && !nowRmb)
+            both = false;
+
+        preLmb = nowLmb;
+        preRmb = nowRmb;
+        preMmb = nowMmb;
+        nowLmb = left;
+        nowRmb = right;
+        nowMmb = middle;
+
+        if (nowLmb && nowRmb)
+            both = true;
+    }
+
+    void update() {
+        press(sf::Mouse::isButtonPressed(sf::Mouse::Left), sf::Mouse::isButtonPressed(sf::Mouse::Right),
+              sf::Mouse::isButtonPressed(sf::Mouse::Middle));
+        pixel = sf::Mouse::getPosition(window);
+        mouse = pixel;
+
+        preUndo = nowUndo;
+        preRedo = nowRedo;
+        nowUndo = window.hasFocus() && sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
+        nowRedo = window.hasFocus() && sf::Keyboard::isKeyPressed(sf::Keyboard::Y);
+    }
 
     /**
-     * нет ничего
+     *  запрос состояния нажатия левой кнопки мыши
+	    выдаёт true только если кнопка была только что поднята
+     * @return
      */
-    NoneQuiestion,
+    bool isClickedLeftButton() {
+        return preLmb && !nowLmb && !both;
+    }
 
     /**
-     * неизвестно и вопрос
+     * то же самое, но для правой
+     * @return
      */
-    UnknownQuestion,
+    bool isClickedRightButton() {
+        return preRmb && !nowRmb && !both;
+    }
 
     /**
-     * тут бомба
+     *  аккорд: отпущена средняя кнопка или отпущена последняя из двух зажатых вместе
+        пока идёт аккорд обеими кнопками, обычные нажатия левой и правой не срабатывают
+     * @return
      */
-    Bomb,
+    bool isClickedChord() {
+        return (preMmb && !nowMmb) || (both && (preLmb || preRmb) && !nowLmb && !nowRmb);
+    }
 
     /**
-     * бомба взорвалась
+     * отмена и повтор срабатывают, как и кнопки мыши, когда клавиша отпущена
+     * @return
      */
-    RedBomb
+    bool isClickedUndo() {
+        return preUndo && !nowUndo;
+    }
 
-};
+    bool isClickedRedo() {
+        return preRedo && !nowRedo;
+    }
+}
 
 /**
  * класс для удобного хранения уровня сложности
@@ -313,218 +394,15 @@ std::array<difficulty_t, 3> difficulties;
 alone::TextureManager textures;
 
 /**
- * то же самое, но для состояний
+ *  номер картинки с тайлами в менеджере текстур
+    ищется один раз при загрузке, а не на каждую новую игру
  */
-alone::StateMachine states;
+alone::TextureManager::Handle tiles_handle;
 
 /**
- * класс карты игры
+ * то же самое, но для состояний
  */
-class Map {
-    /**
-     * позволяет работать с картой игры не напрямую
-     */
-    friend class GameState;
-
-public:
-    /**
-     *  изменение размера карты игры в зависимости от уровня сложности
-	    который берётся из std::array <difficulty_t, 3> difficulties
-     * @param level
-     */
-    void resize(size_t level) {
-        /**
-         * собственно и взятие уровня сложности
-         */
-        auto &d = difficulties[level];
-
-        /**
-         * изменение ширины поля карты
-         */
-        _Content.resize(d.size);
-        for (auto &it: _Content)
-            /**
-             * изменение высота поля, для каждой колонки в отдельности
-             */
-            it.resize(d.size, {'n', Type::None});
-    }
-
-
-    /**
-     *  генерация карты, включая рандомное заполнение
-	    то же берёт заранее заготовленный уровень сложности из std::array <difficulty_t, 3> difficulties
-	    point - это точка, в которую нажал игрок
-	    сделано, чтобы игрок не мог проиграть с первого нажатия
-     * @param level
-     * @param point это точка, в которую нажал игрок
-     */
-
-    void generate(size_t level, sf::Vector2u point) {
-        auto &d = difficulties[level];
-        _Bombs = d.bombs;
-
-        /**
-         *  переменная для незаполненных клеток карты
-		    достаточно много весит, вначале 'размер_грани ^ 2 - 1'
-         */
-        std::set<size_t> unfilled;
-
-        /**
-         *  заполяем все точки с карты так, что элемент с индексом 0 - это левый верхний
-		    а с индексом 10 при ширине в 8 тайлов - это элемент с 'x = 1' и 'y = 2'
-         */
-        for (size_t i = 0; i != d.size * d.size; i++)
-            unfilled.emplace(i);
-
-        /**
-         * убираем ту самую точку, в которую вначале нажал игрок
-         */
-        unfilled.erase(point.x + point.y * d.size);
-
-        /**
-         * рандомный генератор
-         */
-        std::random_device rd;
-
-        /**
-         * заполнение бомб
-         */
-        for (size_t i = 0; i != _Bombs; i++) {
-
-            /**
-             * генерация рандомного индекса числа из сета
-             */
-            std::uniform_int_distribution<size_t> dist(0, unfilled.size() - 1);
-            size_t pos = dist(rd);
-
-            /**
-             *  тупо огромный костыль для работы с std::set, более элегантного решения мы не нашли
-             */
-
-
-            auto it = unfilled.begin();
-            std::advance(it, pos);
-
-            /**
-             *  point - это точка, в которую поместят бомбу
-			    берёт значение итератора из std::set <size_t> unfilled
-             */
-            size_t point = *it;
-            _Content[point % d.size][point / d.size] = {'n', Type::Bomb};
-
-            /**
-             * удаляет это точку из unfilled, тк она уже заполнена
-             */
-            unfilled.erase(point);
-        }
-        //std::cout << '\n';
-
-        /**
-         * заполнение чисел вокруг бомб
-         */
-        for (size_t i = 0; i != _Content.size(); i++) {
-            for (size_t j = 0; j != _Content[i].size(); j++) {
-                /**
-                 * пропускаем, если здесь есть бомба
-                 */
-                if (_Content[i][j].second == Type::Bomb)
-                    continue;
-
-                /**
-                 * проверяет  соседние клетки
-                 */
-                size_t value = _DetectAround(i, j);
-
-                /**
-                 * изменяет значение кол-ва бомб, если их больше 0
-                 */
-                if (value != 0)
-                    _Content[i][j].second = (Type) (value - 1);
-            }
-        }
-    }
-
-private:
-    /**
-     *  костыль из использования char'а как состояния для отрисовки
-	    n - unknown, r - revealed, f - flag
-     */
-    Matrix<std::pair<char, Type>> _Content;
-
-    /**
-     * кол-во бомб на карте
-     */
-    size_t _Bombs;
-
-    /**
-     *  проверяет, есть ли бомба по заданному индексу
-	    если выходит индекс за пределы карты, то возвращает false
-     * @param x
-     * @param y
-     * @return
-     */
-    bool _HasBomb(size_t x, size_t y) {
-        if (x < 0 || x >= _Content.size() || y < 0 || y >= _Content.size())
-            return false;
-        return _Content[x][y].second == Type::Bomb;
-    };
-
-    /**
-     * проверяет все клетки сверху, снизу, по бокам и по диагонали
-     * @param x
-     * @param y
-     * @return
-     */
-    size_t _DetectAround(size_t x, size_t y) {
-        return _HasBomb(x - 1, y - 1) + _HasBomb(x, y - 1) + _HasBomb(x + 1, y - 1) +
-               _HasBomb(x - 1, y) + _HasBomb(x + 1, y) +
-               _HasBomb(x - 1, y + 1) + _HasBomb(x, y + 1) + _HasBomb(x + 1, y + 1);
-    };
-
-    /**
-     *  рукурсивный алгоритм, чтобы открыть тайлы вокруг нажатого
-	    получается рекурсия только в том случае, если игрок нажимает по пустому тайлу
-     * @param x
-     * @param y
-     */
-    void _OpenTiles(int x, int y) {
-        if (y >= _Content.size() || y < 0 || x >= _Content.size() || x < 0)
-            return;
-
-        if (_Content[x][y].first == 'r' || _Content[x][y].second != Type::None) {
-            /**
-             * ставит статус revealed - проверено
-             */
-            _Content[x][y].first = 'r';
-            return;
-        }
-
-        /**
-         * ставит статус revealed - проверено
-         */
-        _Content[x][y].first = 'r';
-
-        /**
-         * проверка верхних
-         */
-        _OpenTiles(x - 1, y - 1);
-        _OpenTiles(x, y - 1);
-        _OpenTiles(x + 1, y - 1);
-
-        /**
-         * по бокам
-         */
-        _OpenTiles(x - 1, y);
-        _OpenTiles(x + 1, y);
-
-        /**
-         * нижних тайлов
-         */
-        _OpenTiles(x - 1, y + 1);
-        _OpenTiles(x, y + 1);
-        _OpenTiles(x + 1, y + 1);
-    }
-};
+alone::StateMachine states;
 
 /**
  * состояние для меню, чтобы было проще ей управлять
@@ -539,7 +417,7 @@ private:
         /**
          * получаем координаты мышки на экране в зависимости от положения самого окна
          */
-        auto mouse = sf::Mouse::getPosition(window);
+        auto mouse = alone::input::mouse;
 
         /**
              * Отдельный массив для кнопек в меню, чтобы легче было их опознавать
@@ -561,11 +439,6 @@ private:
      * создаёт интерфейс для меню и объявляет переменные
      */
     void onCreate() override {
-        /**
-         * устанавливает размер экрана игры
-         */
-        window.setSize(sf::Vector2u(350, 350));
-
         /**
          * изменяет размер динамического массива с кнопками по количеству параметров
          */
@@ -595,6 +468,21 @@ private:
             target.draw(it, states);
     }
 
+    /**
+     * все кнопки одним шрифтом, поэтому рисуются одним вызовом
+     */
+    void submit(alone::RenderQueue &queue) const override {
+        for (const auto &it: _Buttons)
+            queue.submit(alone::RenderQueue::Interface, it);
+    }
+
+    /**
+     * экран меню маленький, в окне он просто увеличивается
+     */
+    sf::Vector2f resolution() const override {
+        return sf::Vector2f(350, 350);
+    }
+
 private:
     /**
      * массив с кнопками, инициализируется только во время вызова метода onCreate
@@ -604,7 +492,7 @@ private:
     /**
      * заранее заготовленные параметры для кнопок, создаются в конструкторе
      */
-    std::array<std::pair<std::string, std::function<void()>>, 4> _Params;
+    std::array<std::pair<std::string, std::function<void()>>, 5> _Params;
 };
 
 /**
@@ -612,21 +500,36 @@ private:
  */
 class GameOverState : public alone::State {
 public:
-    GameOverState(bool status, size_t bombsFound) {
+    /**
+     * @param status 1 - победа, 0 - поражение
+     * @param metrics сложность карты, из неё считаются 3BV/s и эффективность
+     * @param seconds время партии
+     * @param clicks сколько раз игрок нажал на поле
+     */
+    GameOverState(bool status, alone::BoardMetrics metrics = {}, float seconds = 0, size_t clicks = 0) {
         _Status = status;
-        _BombsFound = bombsFound;
+        _Metrics = metrics;
+        _Seconds = seconds;
+        _Clicks = clicks;
     }
 
     sf::Text _Label, _Exit;
     //1 = win, 0 = lose
     bool _Status;
-    size_t _BombsFound;
+    alone::BoardMetrics _Metrics;
+    float _Seconds;
+    size_t _Clicks;
+
+    /**
+     * размер экрана под надписи, считается в onCreate
+     */
+    sf::Vector2f _Resolution{450, 800};
 
     /**
      * обновление экрана
      */
     void update() override {
-        auto mouse = sf::Mouse::getPosition(window);
+        auto mouse = alone::input::mouse;
         auto bounds = _Exit.getGlobalBounds();
 
         /**
@@ -671,9 +574,17 @@ public:
             text += "lose";
 
         /**
-         * текст для количества бомб, которые нашёл игрок
+         *  итог партии: 3BV карты, 3BV в секунду и эффективность - 3BV на одно нажатие
+            дробные числа с двумя знаками, чтобы надпись не прыгала по ширине
          */
-        text += "\n\nYou found " + std::to_string(_BombsFound) + " bombs!";
+        auto fixed = [](double value) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(2) << value;
+            return out.str();
+        };
+        text += "\n\n3BV: " + std::to_string(_Metrics.bbbv);
+        text += "\n3BV/s: " + fixed(_Seconds > 0 ? _Metrics.bbbv / _Seconds : 0);
+        text += "\nEfficiency: " + fixed(_Clicks ? 100.0 * _Metrics.bbbv / _Clicks : 0) + "%";
 
         /**
          * установка шрифта
@@ -716,9 +627,9 @@ public:
 
 
         /**
-         * установка размера окна в зависимости от размера надписи о статусе выигрыша игрока
+         * размер экрана зависит от размера надписи о статусе выигрыша игрока, окно его не меняет
          */
-        window.setSize(sf::Vector2u(labelBounds.width + 80, labelBounds.height + 80 + exitBounds.height));
+        _Resolution = sf::Vector2f(labelBounds.width + 80, labelBounds.height + 80 + exitBounds.height);
     }
 
     void onDelete() override {}
@@ -732,6 +643,15 @@ public:
         target.draw(_Label, states);
         target.draw(_Exit, states);
     }
+
+    void submit(alone::RenderQueue &queue) const override {
+        queue.submit(alone::RenderQueue::Interface, _Label);
+        queue.submit(alone::RenderQueue::Interface, _Exit);
+    }
+
+    sf::Vector2f resolution() const override {
+        return _Resolution;
+    }
 };
 
 /**
@@ -741,12 +661,22 @@ class GameState : public alone::State {
 public:
     /**
      * установка уровня сложности
+     * @param level
+     * @param seed зерно для генерации карты, одинаковое зерно и нажатия дают одинаковую игру
+     * @param practice режим тренировки: ходы можно отменять и повторять, взрыв не заканчивает игру
      */
-    GameState(size_t level) {
+    GameState(size_t level, std::uint64_t seed = std::random_device{}(), bool practice = false) : _Random(seed) {
         _Level = level;
+        _Practice = practice;
     }
 
 private:
+    /**
+     *  арена партии: поле, изменения, рабочие массивы карты и история ходов берут память отсюда
+        память только выделяется и отдаётся вся разом в onDelete, поэтому объявлена раньше всех, кто ей пользуется
+     */
+    std::pmr::monotonic_buffer_resource _Arena{64 * 1024};
+
     /**
      * указатель на карту игры
      */
@@ -758,35 +688,51 @@ private:
     const size_t _InterfaceOffset = 100;
 
     /**
-     * количество заполненных флагов на карте
+     * отрисовка клеток карты тайлами из атласа
      */
-    size_t _Flags = 0;
+    alone::TileRenderer _Tiles;
 
     /**
-     * вершины для отрисовки карты
+     * уровень сложности
      */
-    sf::VertexArray _RenderRegion = sf::VertexArray(sf::Quads);
+    size_t _Level;
 
     /**
-     * атлас с текстурами для быстрой и правильной отрисовки вершин у карты
+     * генератор для карты
      */
-    sf::Texture *_Atlas = nullptr;
+    std::mt19937_64 _Random;
 
     /**
-     * уровень сложности
+     * режим тренировки
      */
-    size_t _Level;
+    bool _Practice;
 
     /**
-     * количество открытых клеток
+     * ходы для отмены и повтора, ведётся только в тренировке
      */
-    size_t _Revealed = 0;
+    alone::History _History{&_Arena};
 
     /**
      * timer
      */
     sf::Clock _Clock;
 
+    /**
+     * сколько раз нажали на поле, для эффективности
+     */
+    size_t _Clicks = 0;
+
+    /**
+     *  карта уже сгенерирована первым нажатием
+        по счётчику открытых это не понять: после отмены всех ходов он снова ноль, а карта та же
+     */
+    bool _Generated = false;
+
+    /**
+     * сколько времени за кадр можно тратить на заливку, ноль - открывать всё в одном кадре
+     */
+    std::chrono::microseconds _FloodBudget{2000};
+
     /**
      * две надписи с прошедшим временем после начала игры и количеством оставшихся бомб
      */
@@ -795,20 +741,6 @@ private:
     char _GameStatus = 'a';
 
     void update() override {
-        /**
-         * размер грани карты
-         */
-        size_t edge_size = _GameMap->_Content.size();
-
-        /**
-         *  меняю размер массива вершин для карты игры
-		    умножаем на 4, так как квадратная карта
-         */
-        _RenderRegion.resize(4 * edge_size * edge_size);
-
-
-        auto &map = _GameMap->_Content;
-
         /**
          * update timer и вывод секунд
          */
@@ -823,208 +755,166 @@ private:
         /**
          * эффекты при нажатии на экран
          */
-        auto mouse = sf::Mouse::getPosition(window);
+        auto mouse = alone::input::mouse;
 
         /**
          * проверка на нажатие
          */
-        bool contains = mouse.x >= 0 && mouse.x <= edge_size * 32 && mouse.y >= _InterfaceOffset &&
-                        mouse.y <= edge_size * 32 + _InterfaceOffset;
+        bool contains = _OnBoard(mouse);
 
         /**
-         * если нажали, то проверяем, что там было
+         *  большая заливка прошлого нажатия открывается по кусочкам, не дольше _FloodBudget за кадр
+            новое нажатие сначала доводит её до конца, чтобы ход шёл по полностью открытой карте
          */
-        if (contains) {
-
-            /**
-             * эта точка, в которую попали мышкой
-             */
-            auto point = sf::Vector2u(mouse.x / 32, (mouse.y - _InterfaceOffset) / 32);
+        bool finished = false;
+        if (_GameMap->pending()) {
+            bool clicked = alone::input::isClickedLeftButton() || alone::input::isClickedRightButton() || alone::input::isClickedChord() ||
+                           alone::input::isClickedUndo() || alone::input::isClickedRedo();
+            if (clicked)
+                _GameMap->settle();
+            else
+                _GameMap->advance(_FloodBudget);
 
             /**
-             * если левая кнопка мыши нажата
+             * ход с заливкой запоминается в тренировке, только когда она закончилась
              */
-            if (alone::input::isClickedLeftButton()) {
-
-                /**
-                 * карта генерируется в момент первого нажатия на карту
-                 */
-                if (_Revealed == 0) {
+            finished = !_GameMap->pending();
+            if (finished && _Practice)
+                _History.record(*_GameMap);
+        }
 
-                    /**
-                     * генерация
-                     */
-                    _GameMap->generate(_Level, point);
+        /**
+         * изменилась ли карта за это обновление
+         */
+        bool moved = false;
 
-                    /**
-                     * устанавливаем текст с количеством оставшихся для поиска бомб
-                     */
-                    _RemainedLabel.setString("Bombs remained: " + std::to_string(_GameMap->_Bombs));
-                    _Revealed++;
+        /**
+         * открыл ли этот ход бомбу, по возвращаемому значению хода, а не по lost()
+         */
+        bool exploded = false;
 
-                    /**
-                     * если сгенерировалось в этой точке ничего, то ищем ближайшие пустые тайлы и с цифрами
-                     */
-                    if (map[point.x][point.y].second == Type::None)
-                        _GameMap->_OpenTiles(point.x, point.y);
-                        /**
-                         * устанавливаем статус отрисовки "видимый"
-                         */
-                    else
-                        map[point.x][point.y].first = 'r';
-                } else {
-                    /**
-                     * если статус отрисовки "неизвестный"
-                     */
-                    if (map[point.x][point.y].first == 'n') {
-                        if (map[point.x][point.y].second == Type::None)
+        /**
+         *  в режиме тренировки Z отменяет ход, а Y повторяет его
+            отмена идёт по записанным изменениям клеток, без снимков всей карты
+         */
+        if (_Practice && (alone::input::isClickedUndo() || alone::input::isClickedRedo())) {
+            moved = alone::input::isClickedUndo() ? _History.undo(*_GameMap) : _History.redo(*_GameMap);
 
-                            /**
-                             * то открываем рядом стоящие пустые тайлы до цифр
-                             */
-                            _GameMap->_OpenTiles(point.x, point.y);
+            /**
+             * если нажали, то проверяем, что там было
+             */
+        } else if (contains) {
 
-                            /**
-                             * установка статуса "видимый"
-                             */
-                        else
-                            map[point.x][point.y].first = 'r';
+            /**
+             * эта точка, в которую попали мышкой
+             */
+            auto point = sf::Vector2u(mouse.x / 32, (mouse.y - _InterfaceOffset) / 32);
 
-                        /**
-                         * если игрок нажал по бомбе левой кнопкой мыши, то он проиграл
-                         */
-                        if (map[point.x][point.y].second == Type::Bomb)
-                            /**
-                             * Игра окончена
-                             */
-                            _GameStatus = 'l';
+            /**
+             * любое нажатие на поле считается, даже если ничего не изменило
+             */
+            if (alone::input::isClickedChord() || alone::input::isClickedLeftButton() || alone::input::isClickedRightButton())
+                _Clicks++;
 
-                        _Revealed++;
-                    }
-                }
+            /**
+             *  аккорд по открытому числу: карта открывает всех незафлаженных соседей за один раз
+                первым нажатием он быть не может, до генерации открытых чисел нет
+             */
+            if (alone::input::isClickedChord()) {
+                exploded = _GameMap->chord(point.x, point.y);
+                moved = !_GameMap->_Dirty.empty();
+                if (moved)
+                    audio.play(alone::Audio::Click);
 
                 /**
-                 * это проверка на нажатие левой кнопкой мыши
+                 * если левая кнопка мыши нажата
                  */
-            } else if (alone::input::isClickedRightButton()) {
+            } else if (alone::input::isClickedLeftButton()) {
 
                 /**
-                 * если изначально статус тайла был флаг
+                 *  карта генерируется в момент первого нажатия на карту
+                    один раз за партию, отмена ходов её не перегенерирует
                  */
-                if (map[point.x][point.y].first == 'f') {
-
-                    /**
-                     * то меняем его на противоположный
-                     */
-                    map[point.x][point.y].first = 'n';
-
-                    /**
-                     * не забываем обновить счётчик бомб
-                     */
-                    _RemainedLabel.setString("Bombs remained: " + std::to_string(++_GameMap->_Bombs));
-
-                    /**
-                     * и уменьшая количество правильно расположенных на карте флагов
-                     */
-
-                    if (map[point.x][point.y].second == Type::Bomb)
-                        _Flags--;
-
-                    /**
-                     * если же на тайле не было флага
-                     */
-                } else if (map[point.x][point.y].first == 'n') {
-
-                    /**
-                     * то ставим его
-                     */
-                    map[point.x][point.y].first = 'f';
-                    _RemainedLabel.setString("Bombs remained: " + std::to_string(--_GameMap->_Bombs));
-
-                    /**
-                     * если всё верно, то инкрементируем счётчик правильных флагов, который не виден игроку
-                     */
-                    if (map[point.x][point.y].second == Type::Bomb)
-                        _Flags++;
-
-                    /**
-                     * если все бомбы найдены, то игра заканчивается, а игрок выигрывает
-                     */
-                    if (_Flags == difficulties[_Level].bombs) {
-                        _GameStatus = 'w';
-                    }
+                if (!_Generated) {
+                    _GameMap->generate(difficulties[_Level].bombs, point.x, point.y, _Random);
+                    _Generated = true;
                 }
-            }
-        }
 
-        /**
-         * расчёт вершин для карты
-         */
-        for (size_t i = 0; i != map.size(); i++) {
-            for (size_t j = 0; j != map[i].size(); j++) {
                 /**
-                 * это 4 вершины одного квадрата
+                 *  установка статуса "видимый", у пустого тайла откроются и рядом стоящие пустые тайлы до цифр
+                    закрытые и зафлаженные клетки карта сама не тронет
+                    на размеченной карте пустая клетка открывает готовую область целиком за один шаг,
+                    а на ленивой областей нет, и заливка идёт волной: сколько успеет за бюджет кадра, остальное - в следующих кадрах
                  */
-                auto &top_lhs = _RenderRegion[(i + j * map.size()) * 4];
-                auto &top_rhs = _RenderRegion[(i + j * map.size()) * 4 + 1];
-                auto &bot_rhs = _RenderRegion[(i + j * map.size()) * 4 + 2];
-                auto &bot_lhs = _RenderRegion[(i + j * map.size()) * 4 + 3];
+                if (_GameMap->lazy()) {
+                    exploded = _GameMap->revealSliced(point.x, point.y);
+                    _GameMap->advance(_FloodBudget);
+                } else
+                    exploded = _GameMap->reveal(point.x, point.y);
+                moved = !_GameMap->_Dirty.empty();
+                if (moved)
+                    audio.play(alone::Audio::Click);
 
                 /**
-                 * это id для отрисовки квадрата, показывает, какую точку у атласа с текстурами рисовать
+                 * это проверка на нажатие левой кнопкой мыши
                  */
-                size_t id = 0;
+            } else if (alone::input::isClickedRightButton()) {
 
                 /**
-                 * если тайл виден игроку, то
+                 *  ставим или снимаем флаг, карта сама ведёт счётчики флагов
+                    до генерации флаги ставить бессмысленно, генерация их сотрёт
                  */
-                if (DEBUG_MODE || map[i][j].first == 'r')
-                    /**
-                     * просто ставим то, что там есть
-                     */
-                    id = (size_t) map[i][j].second;
-                    /**
-                     * если тут флаш, то ставим флаг
-                     */
-                else if (map[i][j].first == 'f')
-                    id = (size_t) Type::Flag;
-                else
-                    /**
-                     * иначе просто рисуем пустоту
-                     */
-                    id = (size_t) Type::Unknown;
+                if (_Generated) {
+                    _GameMap->flag(point.x, point.y);
+                    moved = !_GameMap->_Dirty.empty();
+                    if (moved)
+                        audio.play(alone::Audio::Flag);
+                }
+            }
 
+            /**
+             * в тренировке каждый ход запоминается для отмены
+             */
+            if (moved && _Practice && !_GameMap->pending())
+                _History.record(*_GameMap);
+        }
 
-                /**
-                 * это id с самой текстурами, так как текстура имеет квадратную форму
-                 */
-                size_t idx = id % 4;
-                size_t idy = id / 4;
+        /**
+         *  взрыв определяется по самому ходу: в тренировке открытая бомба остаётся, пока ход не отменят,
+            и lost() правдив на всех следующих ходах, а звук должен быть один раз
+            в тренировке взрыв не заканчивает игру, ход можно отменить
+         */
+        if (exploded) {
+            audio.play(alone::Audio::Explosion);
+            if (!_Practice)
+                _GameStatus = 'l';
+        }
 
-                /**
-                 * расчет местоположения на экране, включая смещение интерфейса по вертикали
-                 */
-                top_lhs.position = sf::Vector2f(i * 32, _InterfaceOffset + j * 32);
-                top_rhs.position = sf::Vector2f(i * 32 + 32, _InterfaceOffset + j * 32);
-                bot_rhs.position = sf::Vector2f(i * 32 + 32, _InterfaceOffset + j * 32 + 32);
-                bot_lhs.position = sf::Vector2f(i * 32, _InterfaceOffset + j * 32 + 32);
+        /**
+         *  победа проверяется по счётчикам карты, без обхода поля
+            все клетки без бомб открыты, флаги для неё не нужны, открытые в тренировке бомбы не мешают
+            пока идёт заливка, итог не проверяется: счётчики ещё не полные
+         */
+        if ((moved || finished) && !_GameMap->pending()) {
+            size_t cells = _GameMap->_Content.size() * _GameMap->_Content.size();
+            if (_GameStatus == 'a' && _GameMap->revealed() == cells - _GameMap->_Bombs)
+                _GameStatus = 'w';
 
-                /**
-                 * расчёт 4 вершин с текстуры, которые соответствуют реальной картинке с экрана
-                 */
-                top_lhs.texCoords = sf::Vector2f(idx * 32.f, idy * 32.f);
-                top_rhs.texCoords = sf::Vector2f(idx * 32.f + 32, idy * 32.f);
-                bot_rhs.texCoords = sf::Vector2f(idx * 32.f + 32, idy * 32.f + 32);
-                bot_lhs.texCoords = sf::Vector2f(idx * 32.f, idy * 32.f + 32);
-            }
+            _RemainedLabel.setString("Bombs remained: " + std::to_string(_GameMap->remaining()));
         }
 
+        /**
+         *  поле рисуется одним квадратом с шейдером по текстуре клеток, в неё уходят только изменения хода
+            если шейдеров нет, рендерер сам считает по 4 вершины на клетку, как раньше
+         */
+        _Tiles.update(*_GameMap, DEBUG_MODE);
+
         /**
          * проверка того, закончилась ли игра
          */
         if (_GameStatus != 'a') {
             states.erase("game");
-            states.insert("over", std::shared_ptr<State>(new GameOverState(_GameStatus == 'w', _Flags)));
+            states.insert("over", std::shared_ptr<State>(new GameOverState(_GameStatus == 'w', alone::measure(*_GameMap), _Clock.getElapsedTime().asSeconds(), _Clicks)));
         }
     }
 
@@ -1033,17 +923,14 @@ private:
          * обнуляем таймер, тк игра началась!
          */
         _Clock.restart();
+        _Clicks = 0;
+        _Generated = false;
 
         /**
          * сбрасываем карту игру и изменяем её размер в зависимости от уровня сложности
          */
-        _GameMap.reset(new Map());
-        _GameMap->resize(_Level);
-
-        /**
-         * количество открытых клеток с карты равно 0
-         */
-        _Revealed = 0;
+        _GameMap.reset(new Map(&_Arena));
+        _GameMap->resize(difficulties[_Level].size);
 
         /**
          * размер ребра карты
@@ -1051,14 +938,10 @@ private:
         size_t edge_size = _GameMap->_Content.size();
 
         /**
-         * размер экрана игры зависит от размера самой карты
-         */
-        window.setSize(sf::Vector2u(edge_size * 32, edge_size * 32 + _InterfaceOffset));
-
-        /**
-         * атлас текстур
+         * атлас текстур и местоположение тайлов в нём
          */
-        _Atlas = &textures["minesweeper.png"];
+        auto& region = textures[tiles_handle];
+        _Tiles.create(edge_size, region.texture, sf::Vector2f(region.rect.left, region.rect.top), sf::Vector2f(0, _InterfaceOffset));
 
         /**
          * установка шрифта для надписей
@@ -1094,10 +977,13 @@ private:
     }
 
     /**
-     * тут же при удалении лучше перестраховаться и обнулить умный указатель
+     *  тут же при удалении лучше перестраховаться и обнулить умный указатель
+        после того, как карта и история отпустили память, арена сбрасывается одним вызовом
      */
     void onDelete() override {
         _GameMap.reset(nullptr);
+        _History.clear();
+        _Arena.release();
     }
 
     /**
@@ -1106,12 +992,102 @@ private:
      * @param states
      */
     void draw(sf::RenderTarget &target, sf::RenderStates states = sf::RenderStates::Default) const override {
-        states.texture = _Atlas;
-        target.draw(_RenderRegion, states);
+        target.draw(_Tiles, states);
 
         target.draw(_RemainedLabel, states);
         target.draw(_TimerLabel, states);
     }
+
+    /**
+     * поле под надписями, надписи буквами из одной текстуры шрифта
+     */
+    void submit(alone::RenderQueue &queue) const override {
+        queue.submit(alone::RenderQueue::Board, _Tiles);
+        queue.submit(alone::RenderQueue::Interface, _RemainedLabel);
+        queue.submit(alone::RenderQueue::Interface, _TimerLabel);
+    }
+
+    /**
+     * размер экрана игры зависит от размера самой карты, до onCreate он берётся из уровня
+     */
+    sf::Vector2f resolution() const override {
+        size_t edge_size = difficulties[_Level].size;
+        return sf::Vector2f(edge_size * 32, edge_size * 32 + _InterfaceOffset);
+    }
+
+    /**
+     *  мышь в координатах состояния над клеткой поля
+        правый и нижний край поля - уже снаружи: в полосы letterbox мышь попадает ровно на край, клетки там нет
+     * @param mouse
+     * @return
+     */
+    bool _OnBoard(sf::Vector2i mouse) const {
+        size_t edge_size = difficulties[_Level].size;
+        return mouse.x >= 0 && (size_t)mouse.x < edge_size * 32 &&
+               mouse.y >= (int)_InterfaceOffset && (size_t)mouse.y < edge_size * 32 + _InterfaceOffset;
+    }
+};
+
+/**
+ *  первое состояние игры, пока в фоне грузятся текстурки
+    окно показывается сразу, а не после декодирования всех картинок
+ */
+class LoadingState : public alone::State {
+public:
+    /**
+     * каждый кадр проверяет, готов ли атлас, и обновляет полоску загрузки
+     */
+    void update() override {
+        if (textures.poll()) {
+            states.erase("loading");
+            states.insert("menu", std::shared_ptr<State>(new MenuState()));
+        }
+
+        float progress = textures.progress();
+        _Bar.setSize(sf::Vector2f(250 * progress, 20));
+        _Label.setString("Loading " + std::to_string((size_t) (progress * 100)) + "%");
+    }
+
+    void onCreate() override {
+        _Label.setFont(font);
+        _Label.setFillColor(sf::Color::White);
+        _Label.setPosition(50, 100);
+
+        _Frame.setSize(sf::Vector2f(250, 20));
+        _Frame.setPosition(50, 150);
+        _Frame.setFillColor(sf::Color::Transparent);
+        _Frame.setOutlineColor(sf::Color::White);
+        _Frame.setOutlineThickness(1);
+
+        _Bar.setPosition(50, 150);
+        _Bar.setFillColor(sf::Color::White);
+    }
+
+    void onDelete() override {}
+
+    /**
+     * отрисовка надписи и полоски загрузки
+     * @param target
+     * @param states
+     */
+    void draw(sf::RenderTarget &target, sf::RenderStates states = sf::RenderStates::Default) const override {
+        target.draw(_Label, states);
+        target.draw(_Frame, states);
+        target.draw(_Bar, states);
+    }
+
+    /**
+     * рамка под полоской загрузки
+     */
+    void submit(alone::RenderQueue &queue) const override {
+        queue.submit(alone::RenderQueue::Background, _Frame);
+        queue.submit(alone::RenderQueue::Interface, _Bar);
+        queue.submit(alone::RenderQueue::Interface, _Label);
+    }
+
+private:
+    sf::Text _Label;
+    sf::RectangleShape _Frame, _Bar;
 };
 
 MenuState::MenuState() {
@@ -1131,6 +1107,13 @@ MenuState::MenuState() {
                 states.insert("game", std::shared_ptr<alone::State>(new GameState(2)));
                 states.erase("menu");
             }),
+            /**
+             * тренировка на среднем уровне: можно отменять ходы
+             */
+            std::make_pair(std::string("Practice"), []() {
+                states.insert("game", std::shared_ptr<alone::State>(new GameState(1, std::random_device{}(), true)));
+                states.erase("menu");
+            }),
             std::make_pair(std::string("Exit"), []() {
                 window.close();
             })
@@ -1138,7 +1121,15 @@ MenuState::MenuState() {
 }
 
 void init() {
-    textures.load("assets/textures/include.txt");
+    /**
+     *  все ресурсы лежат в бандле рядом с исполняемым файлом,
+        поэтому игре неважно, из какой папки её запустили
+     */
+    if (!assets.open(alone::executableDirectory() + "assets.pak"))
+        std::cerr << "failed to open assets.pak\n";
+
+    textures.load(assets, "material/textures/include.txt");
+    tiles_handle = textures.find("minesweeper.png");
 
     /**
      * заполнением параметров уровня сложности
@@ -1150,27 +1141,42 @@ void init() {
     /**
      * погружаем шрифт
      */
-    font.loadFromFile("assets/font.ttf");
+    auto fontData = assets.find("material/font.ttf");
+    font.loadFromMemory(fontData.data(), fontData.size());
+
+    /**
+     * звуковые эффекты декодируются заранее, чтобы при нажатии ничего не грузить
+     */
+    audio.load(assets);
 
     /**
-     * добавляем меню как активное состояние игры
+     *  пока текстурки грузятся в фоне, показываем экран загрузки
+        меню он добавит сам, когда атлас будет готов
      */
-    states.insert("menu", std::shared_ptr<alone::State>(new MenuState()));
+    states.insert("loading", std::shared_ptr<alone::State>(new LoadingState()));
 }
 
-int main() {
+int main(int argc, char **argv) {
     init();
+
+    /**
+     *  --record <начало имени> пишет каждый кадр в png
+        --record-raw <файл> пишет все кадры подряд в один файл RGBA
+     */
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string key = argv[i];
+        if (key == "--record" || key == "--record-raw") {
+            auto format = key == "--record" ? alone::FrameSink::Png : alone::FrameSink::Raw;
+            if (!recorder.start(window.getSize().x, window.getSize().y, argv[i + 1], format))
+                std::cerr << "failed to start recording\n";
+        }
+    }
 	
 	/**
-	* Музыкальное сопровождение
+	* Музыкальное сопровождение, открывается в фоне и заиграет, как только будет готово
 	*/
-    Music music;
-
-
-    music.openFromFile("audio/mysaca.ogg");
-    music.setVolume(50);
+    audio.playMusic("audio/mysaca.ogg", 50);
 
-    music.play();
     while (window.isOpen()) {
 
         /**
@@ -1188,10 +1194,10 @@ int main() {
                     break;
 
                     /**
-                     * /если окну поменяли размер
+                     *  если окну поменяли размер, вид не сбрасывается:
+                        машина состояний каждый кадр заново вписывает экраны состояний в новый размер
                      */
                 case sf::Event::Resized:
-                    window.setView(sf::View(sf::FloatRect(0, 0, event.size.width, event.size.height)));
                     break;
             }
         }
@@ -1211,12 +1217,24 @@ int main() {
          */
         states.update();
 
+        /**
+         * если идёт запись, та же сцена рисуется ещё раз в закадровый буфер
+         */
+        if (recorder.recording())
+            recorder.capture(states, window.getView());
+
         /**
          * выводим на экран
          */
         window.display();
+
+        /**
+         * звук обновляется уже после того, как кадр показан
+         */
+        audio.update();
     }
 
+    recorder.stop();
     return 0;
 }
 
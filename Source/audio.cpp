@@ -0,0 +1,73 @@
+#include "audio.h"
+
+alone::Audio::~Audio() {
+    if (_MusicLoader.joinable())
+        _MusicLoader.join();
+}
+
+void alone::Audio::load(const Bundle& bundle) {
+    _Bundle = &bundle;
+
+    const std::array <std::string, EffectCount> names = {
+            "audio/click.ogg",
+            "audio/flag.ogg",
+            "audio/explosion.ogg"
+    };
+
+    for (size_t i = 0; i != EffectCount; i++) {
+        auto data = bundle.find(names[i]);
+        _Loaded[i] = !data.empty() && _Buffers[i].loadFromMemory(data.data(), data.size());
+    }
+}
+
+void alone::Audio::play(Effect effect) {
+    if (!_Loaded[effect])
+        return;
+
+    //сначала ищем свободный голос, а если все заняты, забираем следующий по кругу
+    size_t voice = _NextVoice;
+    for (size_t i = 0; i != Voices; i++) {
+        if (_Voices[(_NextVoice + i) % Voices].getStatus() == sf::Sound::Stopped) {
+            voice = (_NextVoice + i) % Voices;
+            break;
+        }
+    }
+    _NextVoice = (voice + 1) % Voices;
+
+    _Voices[voice].setBuffer(_Buffers[effect]);
+    _Voices[voice].play();
+}
+
+void alone::Audio::playMusic(std::string name, float volume) {
+    if (_Bundle == nullptr)
+        return;
+
+    //прошлая музыка могла ещё открываться
+    if (_MusicLoader.joinable())
+        _MusicLoader.join();
+    _Music.stop();
+
+    _MusicName = std::move(name);
+    _MusicVolume = volume;
+    _MusicPending = true;
+    _MusicOpened = false;
+
+    //музыка читается прямо из бандла, декодирует её поток самого sfml
+    _MusicLoader = std::thread([this] {
+        auto data = _Bundle->find(_MusicName);
+        _MusicLoaded = !data.empty() && _Music.openFromMemory(data.data(), data.size());
+        _MusicOpened = true;
+    });
+}
+
+void alone::Audio::update() {
+    if (!_MusicPending || !_MusicOpened)
+        return;
+    _MusicPending = false;
+    _MusicLoader.join();
+
+    if (!_MusicLoaded)
+        return;
+    _Music.setVolume(_MusicVolume);
+    _Music.play();
+}
@@ -0,0 +1,85 @@
+#pragma once
+//std
+#include <array>
+#include <string>
+#include <thread>
+#include <atomic>
+
+//sfml
+#include <SFML/Audio.hpp>
+
+#include "bundle.h"
+
+namespace alone {
+    /**
+     *  всё, что звучит в игре
+        звуковые эффекты заранее декодируются в буферы и играются через постоянный набор голосов,
+        поэтому во время нажатия ничего не загружается и не выделяется
+     */
+    class Audio {
+    public:
+        enum Effect {
+            Click,
+            Flag,
+            Explosion,
+            EffectCount
+        };
+
+        /**
+         * одновременно звучит не больше стольких эффектов, самый старый уступает место новому
+         */
+        static constexpr size_t Voices = 8;
+
+        /**
+         * дожидается потока, который открывает музыку
+         */
+        ~Audio();
+
+        /**
+         *  декодирует все эффекты из бандла
+            эффекта может и не быть в бандле, тогда он просто не играет
+         * @param bundle должен жить, пока играет музыка
+         */
+        void load(const Bundle& bundle);
+
+        /**
+         * запуск эффекта, ничего не ждёт и не выделяет
+         * @param effect
+         */
+        void play(Effect effect);
+
+        /**
+         *  открывает музыку в отдельном потоке и сразу возвращает управление
+            разбор заголовков ogg не попадает ни в запуск, ни в кадр: update только запускает готовый поток
+            вызывается после load
+         * @param name путь внутри бандла
+         * @param volume
+         */
+        void playMusic(std::string name, float volume);
+
+        /**
+         * вызывается после каждого показанного кадра, запускает музыку, как только она открыта
+         */
+        void update();
+
+    private:
+        const Bundle* _Bundle = nullptr;
+
+        std::array <sf::SoundBuffer, EffectCount> _Buffers;
+        std::array <bool, EffectCount> _Loaded = {};
+
+        std::array <sf::Sound, Voices> _Voices;
+        size_t _NextVoice = 0;
+
+        sf::Music _Music;
+        std::string _MusicName;
+        float _MusicVolume = 100;
+        bool _MusicPending = false, _MusicLoaded = false;
+
+        /**
+         * _MusicLoaded пишет поток загрузки, а читает главный поток только после join
+         */
+        std::thread _MusicLoader;
+        std::atomic <bool> _MusicOpened = false;
+    };
+}
@@ -0,0 +1,135 @@
+#pragma once
+//std
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <memory_resource>
+
+namespace alone {
+    /**
+     * размер, который узнаётся только во время игры, для своих карт
+     */
+    constexpr size_t DynamicSize = 0;
+
+    /**
+     *  бомбы карты с рамкой в одну клетку по краям
+        клетка (x, y) лежит по индексу (x + 1) + (y + 1) * Stride, в рамке всегда ноль,
+        поэтому у любой клетки поля есть все 8 соседей и подсчёт бомб вокруг идёт без проверок границ
+        размеры уровней известны при сборке: сдвиги соседей - константы, а цикл по ним разворачивается целиком
+     */
+    template <size_t _W, size_t _H>
+    class Board {
+    public:
+        static constexpr size_t Stride = _W + 2;
+
+        /**
+         * сдвиги до соседей в массиве с рамкой
+         */
+        static constexpr std::array <std::ptrdiff_t, 8> Neighbours = {
+            -(std::ptrdiff_t)Stride - 1, -(std::ptrdiff_t)Stride, -(std::ptrdiff_t)Stride + 1,
+            -1, 1,
+            (std::ptrdiff_t)Stride - 1, (std::ptrdiff_t)Stride, (std::ptrdiff_t)Stride + 1
+        };
+
+        constexpr size_t width() const {
+            return _W;
+        }
+
+        constexpr size_t height() const {
+            return _H;
+        }
+
+        void clear() {
+            _Mines.fill(0);
+        }
+
+        void place(size_t x, size_t y) {
+            _Mines[_Index(x, y)] = 1;
+        }
+
+        bool mine(size_t x, size_t y) const {
+            return _Mines[_Index(x, y)];
+        }
+
+        /**
+         * сколько бомб вокруг клетки, восемь сложений без ветвлений
+         */
+        size_t around(size_t x, size_t y) const {
+            auto cell = _Mines.data() + _Index(x, y);
+            return [&] <size_t... _I> (std::index_sequence <_I...>) {
+                return (size_t(cell[Neighbours[_I]]) + ...);
+            }(std::make_index_sequence <Neighbours.size()>{});
+        }
+
+    private:
+        static constexpr size_t _Index(size_t x, size_t y) {
+            return (x + 1) + (y + 1) * Stride;
+        }
+
+        std::array <std::uint8_t, (_W + 2) * (_H + 2)> _Mines{};
+    };
+
+    /**
+     *  то же для размера, заданного во время игры
+        доска живёт у владельца между партиями, resize перевыделяет память, только если её не хватает
+     */
+    template <>
+    class Board <DynamicSize, DynamicSize> {
+    public:
+        Board(size_t width, size_t height, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : _Mines(resource) {
+            resize(width, height);
+        }
+
+        /**
+         * новый размер и пустое поле
+         */
+        void resize(size_t width, size_t height) {
+            _Width = width;
+            _Height = height;
+            _Stride = width + 2;
+            std::ptrdiff_t stride = _Stride;
+            _Neighbours = { -stride - 1, -stride, -stride + 1, -1, 1, stride - 1, stride, stride + 1 };
+            _Mines.assign((width + 2) * (height + 2), 0);
+        }
+
+        size_t width() const {
+            return _Width;
+        }
+
+        size_t height() const {
+            return _Height;
+        }
+
+        void clear() {
+            std::fill(_Mines.begin(), _Mines.end(), 0);
+        }
+
+        void place(size_t x, size_t y) {
+            _Mines[_Index(x, y)] = 1;
+        }
+
+        bool mine(size_t x, size_t y) const {
+            return _Mines[_Index(x, y)];
+        }
+
+        size_t around(size_t x, size_t y) const {
+            auto cell = _Mines.data() + _Index(x, y);
+            size_t count = 0;
+            for (auto it : _Neighbours)
+                count += cell[it];
+            return count;
+        }
+
+    private:
+        size_t _Index(size_t x, size_t y) const {
+            return (x + 1) + (y + 1) * _Stride;
+        }
+
+        size_t _Width, _Height, _Stride;
+        std::array <std::ptrdiff_t, 8> _Neighbours;
+        std::pmr::vector <std::uint8_t> _Mines;
+    };
+}
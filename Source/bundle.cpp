@@ -0,0 +1,200 @@
+#include "bundle.h"
+
+//std
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+alone::Bundle::~Bundle() {
+    close();
+}
+
+bool alone::Bundle::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    _File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_File == INVALID_HANDLE_VALUE) {
+        _File = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_File, &size) || size.QuadPart < (LONGLONG)sizeof(Header)) {
+        close();
+        return false;
+    }
+
+    _Mapping = CreateFileMappingA(_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_Mapping == nullptr) {
+        close();
+        return false;
+    }
+
+    _Data = (const std::byte*)MapViewOfFile(_Mapping, FILE_MAP_READ, 0, 0, 0);
+    _Size = size.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size < (off_t)sizeof(Header)) {
+        ::close(file);
+        return false;
+    }
+
+    //отображение живёт и после закрытия дескриптора
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+        return false;
+
+    _Data = (const std::byte*)data;
+    _Size = info.st_size;
+#endif
+
+    if (_Data == nullptr) {
+        close();
+        return false;
+    }
+
+    //проверка заголовка и того, что индекс целиком помещается в файл
+    auto header = (const Header*)_Data;
+    if (std::memcmp(header->magic, "SAPR", 4) != 0 || header->version != _Version ||
+        header->count > (_Size - sizeof(Header)) / sizeof(Record)) {
+        close();
+        return false;
+    }
+
+    _Count = header->count;
+    _Records = (const Record*)(_Data + sizeof(Header));
+    _Names = (const char*)(_Records + _Count);
+
+    size_t namesEnd = (const std::byte*)_Names - _Data;
+    for (std::uint32_t i = 0; i != _Count; i++) {
+        auto& record = _Records[i];
+        if (record.offset > _Size || record.size > _Size - record.offset ||
+            namesEnd + record.nameOffset + record.nameSize > _Size) {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void alone::Bundle::close() {
+#ifdef _WIN32
+    if (_Data != nullptr)
+        UnmapViewOfFile(_Data);
+    if (_Mapping != nullptr)
+        CloseHandle(_Mapping);
+    if (_File != nullptr)
+        CloseHandle(_File);
+    _Mapping = _File = nullptr;
+#else
+    if (_Data != nullptr)
+        munmap((void*)_Data, _Size);
+#endif
+
+    _Data = nullptr;
+    _Size = 0;
+    _Records = nullptr;
+    _Names = nullptr;
+    _Count = 0;
+}
+
+std::span <const std::byte> alone::Bundle::find(const std::string& name) const {
+    auto nameOf = [this](const Record& record) {
+        return std::string_view(_Names + record.nameOffset, record.nameSize);
+    };
+
+    //записи в индексе отсортированы по имени, поэтому ищем бинарным поиском
+    auto end = _Records + _Count;
+    auto it = std::lower_bound(_Records, end, name, [&](const Record& record, const std::string& key) {
+        return nameOf(record) < key;
+    });
+
+    if (it == end || nameOf(*it) != name)
+        return {};
+    return { _Data + it->offset, (size_t)it->size };
+}
+
+bool alone::Bundle::write(const std::string& path, const std::vector <std::pair <std::string, std::string>>& files) {
+    std::vector <size_t> order(files.size());
+    for (size_t i = 0; i != order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return files[lhs].first < files[rhs].first;
+    });
+
+    Header header = { { 'S', 'A', 'P', 'R' }, _Version, (std::uint32_t)files.size(), 0 };
+
+    std::string names;
+    std::vector <Record> records;
+    for (auto i : order) {
+        records.push_back({ 0, files[i].second.size(), (std::uint32_t)names.size(), (std::uint32_t)files[i].first.size() });
+        names += files[i].first;
+    }
+
+    auto align = [](std::uint64_t value) {
+        return (value + _Alignment - 1) / _Alignment * _Alignment;
+    };
+
+    std::uint64_t offset = align(sizeof(Header) + records.size() * sizeof(Record) + names.size());
+    for (auto& it : records) {
+        it.offset = offset;
+        offset = align(offset + it.size);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)records.data(), records.size() * sizeof(Record));
+    file.write(names.data(), names.size());
+
+    for (size_t i = 0; i != order.size(); i++) {
+        auto& content = files[order[i]].second;
+        std::uint64_t padding = records[i].offset - (std::uint64_t)file.tellp();
+        file.write(std::string(padding, '\0').data(), padding);
+        file.write(content.data(), content.size());
+    }
+
+    return (bool)file;
+}
+
+std::string alone::executableDirectory() {
+    std::string path;
+
+#ifdef _WIN32
+    char buffer[MAX_PATH];
+    DWORD size = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+    if (size != 0 && size != MAX_PATH)
+        path.assign(buffer, size);
+#elif defined(__linux__)
+    char buffer[4096];
+    ssize_t size = readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (size > 0 && size < (ssize_t)sizeof(buffer))
+        path.assign(buffer, size);
+#endif
+
+    auto slash = path.find_last_of("/\\");
+    if (slash == std::string::npos)
+        return "";
+    return path.substr(0, slash + 1);
+}
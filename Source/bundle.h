@@ -0,0 +1,87 @@
+#pragma once
+//std
+#include <string>
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace alone {
+    /**
+     *  один файл со всеми ресурсами игры, который целиком отображается в память
+        устройство файла:
+            заголовок  - "SAPR", версия, количество записей
+            индекс     - смещение, размер и имя каждой записи
+            имена      - все имена подряд
+            данные     - содержимое файлов, каждый выровнен по 64 байта
+        числа записываются в порядке байт машины, на которой собирали бандл
+     */
+    class Bundle {
+    public:
+        Bundle() = default;
+        Bundle(const Bundle&) = delete;
+        Bundle& operator=(const Bundle&) = delete;
+        ~Bundle();
+
+        /**
+         *  отображает файл бандла в память, ничего не копируя
+            данные остаются доступны, пока жив сам бандл
+         * @param path
+         * @return false, если файла нет или он повреждён
+         */
+        bool open(const std::string& path);
+
+        void close();
+
+        /**
+         * @param name путь файла внутри бандла, например "material/font.ttf"
+         * @return содержимое файла или пустой span, если такого нет
+         */
+        std::span <const std::byte> find(const std::string& name) const;
+
+        /**
+         *  запись нового бандла, используется утилитой сборки
+         * @param path куда записать
+         * @param files пары из имени внутри бандла и содержимого
+         * @return
+         */
+        static bool write(const std::string& path, const std::vector <std::pair <std::string, std::string>>& files);
+
+    private:
+        struct Header {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t count;
+            std::uint32_t reserved;
+        };
+
+        struct Record {
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::uint32_t nameOffset;
+            std::uint32_t nameSize;
+        };
+
+        static constexpr std::uint32_t _Version = 1;
+        static constexpr std::uint64_t _Alignment = 64;
+
+        const std::byte* _Data = nullptr;
+        size_t _Size = 0;
+
+        const Record* _Records = nullptr;
+        const char* _Names = nullptr;
+        std::uint32_t _Count = 0;
+
+#ifdef _WIN32
+        void* _File = nullptr;
+        void* _Mapping = nullptr;
+#endif
+    };
+
+    /**
+     *  папка, в которой лежит исполняемый файл игры
+        ресурсы ищутся от неё, а не от рабочей папки
+     * @return путь с завершающим разделителем или пустая строка, если узнать не вышло
+     */
+    std::string executableDirectory();
+}
@@ -0,0 +1,46 @@
+//утилита сборки бандла ресурсов, запускается из cmake
+//SaperBundle <куда записать> <папка>...
+//файлы внутри бандла называются относительно родителя папки, например "material/font.ttf"
+
+#include "bundle.h"
+
+//std
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <output> <directory>...\n";
+        return 1;
+    }
+
+    std::vector <std::pair <std::string, std::string>> files;
+    for (int i = 2; i < argc; i++) {
+        std::filesystem::path root(argv[i]);
+        if (!std::filesystem::is_directory(root)) {
+            std::cerr << "skipping missing directory " << root << '\n';
+            continue;
+        }
+
+        for (auto& it : std::filesystem::recursive_directory_iterator(root)) {
+            if (!it.is_regular_file())
+                continue;
+
+            std::ifstream file(it.path(), std::ios::binary);
+            std::stringstream content;
+            content << file.rdbuf();
+
+            auto name = std::filesystem::relative(it.path(), root.parent_path()).generic_string();
+            files.emplace_back(name, content.str());
+        }
+    }
+
+    if (!alone::Bundle::write(argv[1], files)) {
+        std::cerr << "failed to write " << argv[1] << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "delta.h"
+
+//std
+#include <algorithm>
+
+namespace {
+    bool readNumber(const std::string& in, size_t& position, std::uint64_t& value) {
+        value = 0;
+        for (size_t shift = 0; shift < 64 && position != in.size(); shift += 7) {
+            auto byte = (std::uint8_t)in[position++];
+            value |= (std::uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+}
+
+alone::DeltaEncoder::DeltaEncoder(size_t interval) {
+    _Interval = interval;
+}
+
+void alone::DeltaEncoder::_Number(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+size_t alone::DeltaEncoder::_Sort(const std::pmr::vector <size_t>& dirty) {
+    //при заливке клетки идут в порядке обхода, а отрезкам нужен порядок номеров
+    _Sorted.assign(dirty.begin(), dirty.end());
+    std::sort(_Sorted.begin(), _Sorted.end());
+    _Sorted.erase(std::unique(_Sorted.begin(), _Sorted.end()), _Sorted.end());
+
+    size_t runs = 0;
+    for (size_t i = 0; i != _Sorted.size(); i++)
+        runs += i == 0 || _Sorted[i] != _Sorted[i - 1] + 1;
+    return runs;
+}
+
+bool alone::DeltaDecoder::apply(const std::string& message) {
+    size_t position = 1;
+    std::uint64_t sequence, size, runs;
+    if (message.empty() || (message[0] != 'k' && message[0] != 'd') ||
+        !readNumber(message, position, sequence) || !readNumber(message, position, size) || !readNumber(message, position, runs)) {
+        _Synced = false;
+        return false;
+    }
+
+    bool key = message[0] == 'k';
+    if (key ? size > MaxSize : !_Synced || sequence != _Expected || size != _Size) {
+        //пропустили сообщение - ждём ключевой кадр
+        _Synced = false;
+        return false;
+    }
+
+    //сначала проверка, потом запись: битое сообщение не должно оставить карту наполовину применённой
+    if (!_Runs(message, position, runs, size * size, false)) {
+        _Synced = false;
+        return false;
+    }
+
+    if (key) {
+        _Size = size;
+        _Board.assign(size * size, (std::uint8_t)Type::Unknown);
+        _Synced = true;
+    }
+    _Runs(message, position, runs, size * size, true);
+    _Expected = sequence + 1;
+    return true;
+}
+
+bool alone::DeltaDecoder::_Runs(const std::string& message, size_t position, std::uint64_t runs, size_t cells, bool write) {
+    size_t previous = 0;
+    for (std::uint64_t run = 0; run != runs; run++) {
+        std::uint64_t gap, length;
+        if (!readNumber(message, position, gap) || !readNumber(message, position, length) ||
+            gap > cells - previous || length > cells - previous - gap)
+            return false;
+
+        size_t i = previous + gap, end = i + length;
+        while (i != end) {
+            std::uint64_t repeat;
+            if (position == message.size())
+                return false;
+            auto value = (std::uint8_t)message[position++];
+            if (!readNumber(message, position, repeat) || repeat == 0 || repeat > end - i)
+                return false;
+            if (write)
+                std::fill_n(_Board.begin() + i, repeat, value);
+            i += repeat;
+        }
+        previous = end;
+    }
+    return position == message.size();
+}
+
+bool alone::DeltaDecoder::synced() const {
+    return _Synced;
+}
+
+size_t alone::DeltaDecoder::size() const {
+    return _Size;
+}
+
+const std::vector <std::uint8_t>& alone::DeltaDecoder::board() const {
+    return _Board;
+}
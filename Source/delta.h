@@ -0,0 +1,166 @@
+#pragma once
+//std
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     * самая большая сторона карты в протоколе, и сервер, и зритель больше не принимают
+     */
+    const size_t MaxSize = 256;
+
+    /**
+     *  сжатая передача изменений карты для удалённых зрителей
+        сообщение:
+            u8 вид: 'k' - ключевой кадр со всей картой, 'd' - изменения за ход
+            номер сообщения, размер карты, количество отрезков
+            отрезки подряд идущих номеров клеток (x + y * размер): отступ от конца предыдущего отрезка, длина,
+            затем значения клеток парами (u8 значение из Map::visible, сколько раз повторяется)
+        все числа, кроме байтов вида и значения, записываются переменной длиной по 7 бит
+        ключевой кадр - это один отрезок на всю карту, так что формат у них общий
+     */
+    class DeltaEncoder {
+    public:
+        /**
+         * @param interval каждое interval-е сообщение - ключевой кадр, 0 - только первое
+         */
+        explicit DeltaEncoder(size_t interval = 64);
+
+        /**
+         *  изменения последнего хода (board._Dirty), или ключевой кадр, если подошла его очередь
+         * @param board Map или другая карта на alone::Engine с квадратной топологией и visible(index)
+         * @param out сообщение дописывается в конец
+         */
+        template <class _Board>
+        void encode(const _Board& board, std::string& out) {
+            //номера сообщений начинаются с единицы, первое всегда ключевое
+            bool key = _Sequence == 0 || (_Interval != 0 && _Sequence % _Interval == 0);
+            _Sequence++;
+            _Write(board, key ? 'k' : 'd', out);
+        }
+
+        /**
+         * ключевой кадр вне очереди, например для только что подключившегося зрителя
+         */
+        template <class _Board>
+        void keyframe(const _Board& board, std::string& out) {
+            //вне очереди номер не растёт, кадр описывает состояние после последнего сообщения
+            _Write(board, 'k', out);
+        }
+
+    private:
+        template <class _Board>
+        void _Write(const _Board& board, char kind, std::string& out);
+
+        /**
+         * отрезок [start, start + length) с повторами значений
+         */
+        template <class _Board>
+        static void _Run(const _Board& board, std::string& out, size_t start, size_t length);
+
+        /**
+         * число переменной длиной по 7 бит
+         */
+        static void _Number(std::string& out, std::uint64_t value);
+
+        /**
+         *  отсортированные номера изменившихся клеток в _Sorted
+         * @return сколько в них отрезков подряд идущих номеров
+         */
+        size_t _Sort(const std::pmr::vector <size_t>& dirty);
+
+        size_t _Interval;
+        size_t _Sequence = 0;
+
+        /**
+         * отсортированные номера изменившихся клеток, переиспользуется
+         */
+        std::vector <std::uint32_t> _Sorted;
+    };
+
+    template <class _Board>
+    void DeltaEncoder::_Write(const _Board& board, char kind, std::string& out) {
+        size_t size = board.topology().width();
+        out.push_back(kind);
+        _Number(out, _Sequence);
+        _Number(out, size);
+
+        if (kind == 'k') {
+            _Number(out, 1);
+            _Number(out, 0);
+            _Run(board, out, 0, size * size);
+            return;
+        }
+
+        _Number(out, _Sort(board._Dirty));
+        size_t previous = 0;
+        for (size_t i = 0; i != _Sorted.size();) {
+            size_t length = 1;
+            while (i + length != _Sorted.size() && _Sorted[i + length] == _Sorted[i] + length)
+                length++;
+
+            _Number(out, _Sorted[i] - previous);
+            _Run(board, out, _Sorted[i], length);
+            previous = _Sorted[i] + length;
+            i += length;
+        }
+    }
+
+    template <class _Board>
+    void DeltaEncoder::_Run(const _Board& board, std::string& out, size_t start, size_t length) {
+        _Number(out, length);
+
+        size_t i = start, end = start + length;
+        while (i != end) {
+            auto value = board.visible(i);
+            size_t repeat = 1;
+            while (i + repeat != end && board.visible(i + repeat) == value)
+                repeat++;
+
+            out.push_back((char)value);
+            _Number(out, repeat);
+            i += repeat;
+        }
+    }
+
+    /**
+     *  сборка карты зрителя из сообщений DeltaEncoder
+        карта хранится как байты Map::visible в порядке x + y * размер
+     */
+    class DeltaDecoder {
+    public:
+        /**
+         *  применяет одно сообщение
+            сообщение сначала проверяется целиком, битое не меняет ни карту, ни ожидаемый номер
+            если пропущено или битое сообщение, изменения игнорируются до следующего ключевого кадра
+         * @param message
+         * @return false, если сообщение битое или не применено
+         */
+        bool apply(const std::string& message);
+
+        /**
+         * было ли применено хоть одно сообщение после последнего ключевого кадра без пропусков
+         */
+        bool synced() const;
+
+        size_t size() const;
+        const std::vector <std::uint8_t>& board() const;
+
+    private:
+        /**
+         *  проходит по отрезкам сообщения начиная с position
+         * @param cells сколько клеток в карте, к которой относится сообщение
+         * @param write false - только проверить, true - записать в _Board
+         * @return false, если отрезки выходят за карту или сообщение не кончилось вместе с ними
+         */
+        bool _Runs(const std::string& message, size_t position, std::uint64_t runs, size_t cells, bool write);
+
+        std::vector <std::uint8_t> _Board;
+        size_t _Size = 0;
+        size_t _Expected = 0;
+        bool _Synced = false;
+    };
+}
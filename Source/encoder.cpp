@@ -0,0 +1,139 @@
+#include "encoder.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ALONE_SSE2
+#endif
+
+//кодировщик читает клетки как пары байт: состояние, значение
+static_assert(sizeof(std::pair <char, Type>) == 2);
+
+namespace {
+    //байт значения, которым в карте записано число k
+    std::uint8_t numberValue(size_t k) {
+        return k == 0 ? (std::uint8_t)Type::None : (std::uint8_t)(k - 1);
+    }
+
+    void encodeCell(const std::uint8_t* cell, std::uint8_t* planes, size_t cells, size_t i) {
+        bool revealed = cell[0] == 'r';
+        planes[alone::Encoder::Revealed * cells + i] = revealed;
+        planes[alone::Encoder::Flagged * cells + i] = cell[0] == 'f';
+        for (size_t k = 0; k != 9; k++)
+            planes[(alone::Encoder::Number0 + k) * cells + i] = revealed && cell[1] == numberValue(k);
+    }
+
+    bool isFrontier(const std::uint8_t* revealed, size_t size, size_t x, size_t y) {
+        if (revealed[x + y * size])
+            return false;
+
+        for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < size; j++)
+            for (size_t i = x == 0 ? 0 : x - 1; i <= x + 1 && i < size; i++)
+                if (revealed[i + j * size])
+                    return true;
+        return false;
+    }
+}
+
+void alone::Encoder::encode(const Map& map, std::uint8_t* planes) {
+    size_t size = map._Content.size(), cells = size * size;
+    auto data = (const std::uint8_t*)map._Content.data();
+
+    size_t i = 0;
+#ifdef ALONE_SSE2
+    const __m128i low = _mm_set1_epi16(0x00FF);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i revealedState = _mm_set1_epi8('r');
+    const __m128i flaggedState = _mm_set1_epi8('f');
+
+    __m128i numbers[9];
+    for (size_t k = 0; k != 9; k++)
+        numbers[k] = _mm_set1_epi8((char)numberValue(k));
+
+    for (; i + 16 <= cells; i += 16) {
+        __m128i lhs = _mm_loadu_si128((const __m128i*)(data + 2 * i));
+        __m128i rhs = _mm_loadu_si128((const __m128i*)(data + 2 * i + 16));
+
+        //разбираем 16 пар на 16 состояний и 16 значений
+        __m128i state = _mm_packus_epi16(_mm_and_si128(lhs, low), _mm_and_si128(rhs, low));
+        __m128i value = _mm_packus_epi16(_mm_srli_epi16(lhs, 8), _mm_srli_epi16(rhs, 8));
+
+        __m128i revealed = _mm_cmpeq_epi8(state, revealedState);
+        _mm_storeu_si128((__m128i*)(planes + Revealed * cells + i), _mm_and_si128(revealed, one));
+        _mm_storeu_si128((__m128i*)(planes + Flagged * cells + i), _mm_and_si128(_mm_cmpeq_epi8(state, flaggedState), one));
+
+        revealed = _mm_and_si128(revealed, one);
+        for (size_t k = 0; k != 9; k++) {
+            __m128i number = _mm_and_si128(_mm_cmpeq_epi8(value, numbers[k]), revealed);
+            _mm_storeu_si128((__m128i*)(planes + (Number0 + k) * cells + i), number);
+        }
+    }
+#endif
+    for (; i != cells; i++)
+        encodeCell(data + 2 * i, planes, cells, i);
+
+    //граница считается как расширение открытых клеток на соседей: сначала по строке, потом по столбцу
+    const std::uint8_t* revealed = planes + Revealed * cells;
+    std::uint8_t* frontier = planes + Frontier * cells;
+
+    //после самой матрицы лежит строка нулей, она подставляется вместо соседей за краем
+    _Scratch.assign(cells + size, 0);
+    std::uint8_t* wide = _Scratch.data();
+    const std::uint8_t* zero = wide + cells;
+
+    for (size_t y = 0; y != size; y++) {
+        auto row = revealed + y * size;
+        auto out = wide + y * size;
+
+        out[0] = row[0] | (size > 1 && row[1]);
+        size_t x = 1;
+#ifdef ALONE_SSE2
+        for (; x + 17 <= size; x += 16) {
+            __m128i left = _mm_loadu_si128((const __m128i*)(row + x - 1));
+            __m128i mid = _mm_loadu_si128((const __m128i*)(row + x));
+            __m128i right = _mm_loadu_si128((const __m128i*)(row + x + 1));
+            _mm_storeu_si128((__m128i*)(out + x), _mm_or_si128(_mm_or_si128(left, mid), right));
+        }
+#endif
+        for (; x < size; x++)
+            out[x] = row[x - 1] | row[x] | (x + 1 < size && row[x + 1]);
+    }
+
+    for (size_t y = 0; y != size; y++) {
+        auto up = y == 0 ? zero : wide + (y - 1) * size;
+        auto mid = wide + y * size;
+        auto down = y + 1 == size ? zero : wide + (y + 1) * size;
+        auto row = revealed + y * size;
+        auto out = frontier + y * size;
+
+        size_t x = 0;
+#ifdef ALONE_SSE2
+        for (; x + 16 <= size; x += 16) {
+            __m128i around = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i*)(up + x)),
+                                                       _mm_loadu_si128((const __m128i*)(mid + x))),
+                                          _mm_loadu_si128((const __m128i*)(down + x)));
+            __m128i open = _mm_loadu_si128((const __m128i*)(row + x));
+            _mm_storeu_si128((__m128i*)(out + x), _mm_andnot_si128(open, around));
+        }
+#endif
+        for (; x != size; x++)
+            out[x] = (up[x] | mid[x] | down[x]) & !row[x];
+    }
+}
+
+void alone::Encoder::update(const Map& map, std::uint8_t* planes) {
+    size_t size = map._Content.size(), cells = size * size;
+    auto data = (const std::uint8_t*)map._Content.data();
+
+    for (auto i : map._Dirty)
+        encodeCell(data + 2 * i, planes, cells, i);
+
+    //от открытия клетки граница меняется только у неё самой и у её соседей
+    const std::uint8_t* revealed = planes + Revealed * cells;
+    std::uint8_t* frontier = planes + Frontier * cells;
+    for (auto i : map._Dirty) {
+        size_t x = i % size, y = i / size;
+        for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < size; j++)
+            for (size_t k = x == 0 ? 0 : x - 1; k <= x + 1 && k < size; k++)
+                frontier[k + j * size] = isFrontier(revealed, size, k, j);
+    }
+}
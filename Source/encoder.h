@@ -0,0 +1,62 @@
+#pragma once
+//std
+#include <vector>
+#include <cstdint>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     *  видимая часть карты в виде плоскостей признаков для агентов и решателей
+        каждая плоскость - size * size байт со значениями 0 или 1 в порядке x + y * size,
+        плоскости лежат в буфере одна за другой
+     */
+    class Encoder {
+    public:
+        enum Plane {
+            /**
+             * клетка открыта
+             */
+            Revealed,
+
+            /**
+             * на клетке флаг
+             */
+            Flagged,
+
+            /**
+             * открытая клетка с числом от 0 до 8, Number0 + число
+             */
+            Number0,
+
+            /**
+             * закрытая клетка, у которой есть открытый сосед
+             */
+            Frontier = Number0 + 9,
+
+            PlaneCount
+        };
+
+        /**
+         *  полное кодирование всей карты
+            на x86 по 16 клеток за раз через SSE2, иначе по одной
+         * @param map
+         * @param planes PlaneCount * size * size байт
+         */
+        void encode(const Map& map, std::uint8_t* planes);
+
+        /**
+         *  обновление только тех клеток, которые изменились за последний ход (map._Dirty), и их соседей
+            planes должны содержать кодирование карты до этого хода
+         * @param map
+         * @param planes
+         */
+        void update(const Map& map, std::uint8_t* planes);
+
+    private:
+        /**
+         * промежуточная горизонтальная свёртка для поиска границы
+         */
+        std::vector <std::uint8_t> _Scratch;
+    };
+}
@@ -0,0 +1,114 @@
+#include "environment.h"
+#include "generator.h"
+
+//std
+#include <cstring>
+
+namespace {
+    //столько сред подряд обрабатывает один поток за раз
+    const size_t Block = 256;
+}
+
+alone::Environment::Environment(size_t size, size_t bombs) {
+    _Size = size;
+    _Bombs = bombs;
+
+    //агенту области не видны, а без них открытие идёт той же заливкой
+    _Map.regions(false);
+    _Map.resize(size);
+}
+
+void alone::Environment::reset(std::uint64_t seed, std::uint8_t* observation) {
+    _Random.seed(seed);
+    _Started = false;
+
+    _Map._Content.fill({ 'n', Type::None });
+    std::memset(observation, (std::uint8_t)Type::Unknown, cells());
+}
+
+alone::Environment::Step alone::Environment::step(size_t action, std::uint8_t* observation) {
+    size_t cells = this->cells();
+    if (action >= 2 * cells)
+        return { _Rewards.wasted, false };
+
+    size_t x = action % cells % _Size, y = action % cells / _Size;
+    bool bomb = false;
+
+    if (action < cells) {
+        //как и в игре, карта генерируется в момент первого открытия
+        if (!_Started) {
+            _Map.generate(_Bombs, x, y, _Random);
+            _Started = true;
+        }
+        bomb = _Map.reveal(x, y);
+    } else {
+        //до генерации флаги ставить бессмысленно, генерация их сотрёт
+        if (!_Started)
+            return { _Rewards.wasted, false };
+        _Map.flag(x, y);
+    }
+
+    for (auto it : _Map._Dirty)
+        observation[it] = _Map.visible(it);
+
+    if (_Map._Dirty.empty())
+        return { _Rewards.wasted, false };
+    if (bomb)
+        return { _Rewards.lose, true };
+    if (action >= cells)
+        return { 0, false };
+
+    float reward = _Rewards.progress * _Map._Dirty.size() / (cells - _Bombs);
+    if (_Map.won())
+        return { reward + _Rewards.win, true };
+    return { reward, false };
+}
+
+size_t alone::Environment::cells() const {
+    return _Size * _Size;
+}
+
+alone::VectorEnvironment::VectorEnvironment(size_t count, size_t size, size_t bombs, size_t threads) {
+    _Content.assign(count, Environment(size, bombs));
+    _Seeds.resize(count);
+
+    //больше потоков, чем блоков, всё равно не понадобится
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    _Pool = std::make_unique <ThreadPool>(std::max <size_t>(1, std::min(threads, (count + Block - 1) / Block)));
+}
+
+void alone::VectorEnvironment::reset(std::uint64_t seed, std::uint8_t* observations) {
+    size_t cells = this->cells();
+    _Pool->run((_Content.size() + Block - 1) / Block, [&](size_t block, size_t) {
+        for (size_t i = block * Block; i != std::min(_Content.size(), (block + 1) * Block); i++) {
+            _Seeds[i] = streamSeed(seed, i);
+            _Content[i].reset(_Seeds[i], observations + i * cells);
+        }
+    });
+}
+
+void alone::VectorEnvironment::step(const std::uint32_t* actions, std::uint8_t* observations, float* rewards, std::uint8_t* dones) {
+    size_t cells = this->cells();
+    _Pool->run((_Content.size() + Block - 1) / Block, [&](size_t block, size_t) {
+        for (size_t i = block * Block; i != std::min(_Content.size(), (block + 1) * Block); i++) {
+            auto result = _Content[i].step(actions[i], observations + i * cells);
+            rewards[i] = result.reward;
+            dones[i] = result.done;
+
+            //следующее зерно выводится из предыдущего, поэтому весь прогон повторяем
+            if (result.done) {
+                _Seeds[i] = streamSeed(_Seeds[i], 0);
+                _Content[i].reset(_Seeds[i], observations + i * cells);
+            }
+        }
+    });
+}
+
+size_t alone::VectorEnvironment::size() const {
+    return _Content.size();
+}
+
+size_t alone::VectorEnvironment::cells() const {
+    return _Content.empty() ? 0 : _Content.front().cells();
+}
@@ -0,0 +1,93 @@
+#pragma once
+//std
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <memory>
+
+#include "map.h"
+#include "parallel.h"
+
+namespace alone {
+    /**
+     *  среда для обучения агентов поверх карты, без окна и без sfml
+        наблюдение - один байт на клетку в порядке x + y * размер, значения берутся из Type:
+            открытая клетка - число, None или Bomb
+            закрытая - Unknown
+            с флагом - Flag
+        действие - номер клетки: меньше size * size - открыть клетку, иначе - поставить или снять флаг
+        на клетку action - size * size
+     */
+    class Environment {
+    public:
+        /**
+         * награды за ход, можно менять до начала обучения
+         */
+        struct Rewards {
+            //за всё поле целиком, делится между открытыми клетками
+            float progress = 1;
+            float win = 1;
+            float lose = -1;
+            //ход, который ничего не изменил
+            float wasted = -0.01f;
+        };
+
+        struct Step {
+            float reward;
+            bool done;
+        };
+
+        Environment(size_t size, size_t bombs);
+
+        /**
+         *  новая партия, карта появится после первого открытия, как и в игре
+         * @param seed
+         * @param observation size * size байт, заполняется целиком
+         */
+        void reset(std::uint64_t seed, std::uint8_t* observation);
+
+        /**
+         * @param action
+         * @param observation переписываются только изменившиеся клетки
+         * @return
+         */
+        Step step(size_t action, std::uint8_t* observation);
+
+        size_t cells() const;
+
+        Rewards _Rewards;
+
+    private:
+        Map _Map;
+        std::mt19937_64 _Random;
+        size_t _Size, _Bombs;
+        bool _Started = false;
+    };
+
+    /**
+     *  много сред сразу, все буферы лежат структурой массивов и принадлежат вызывающему:
+            observations - count * cells байт
+            actions, rewards, dones - по одному элементу на среду
+        закончившаяся среда сразу начинает новую партию, а в dones остаётся отметка
+        потоки создаются один раз в конструкторе и переиспользуются всеми reset и step
+     */
+    class VectorEnvironment {
+    public:
+        VectorEnvironment(size_t count, size_t size, size_t bombs, size_t threads = 0);
+
+        /**
+         *  среда номер i получает зерно streamSeed(seed, i)
+         */
+        void reset(std::uint64_t seed, std::uint8_t* observations);
+
+        void step(const std::uint32_t* actions, std::uint8_t* observations, float* rewards, std::uint8_t* dones);
+
+        size_t size() const;
+        size_t cells() const;
+
+    private:
+        std::vector <Environment> _Content;
+        std::vector <std::uint64_t> _Seeds;
+        std::unique_ptr <ThreadPool> _Pool;
+    };
+}
@@ -0,0 +1,81 @@
+#include "generator.h"
+#include "parallel.h"
+#include "map.h"
+
+//std
+#include <fstream>
+#include <cstring>
+
+namespace {
+    //генерация карт с номерами от first, first обязательно кратен BatchStream
+    void generateRange(const alone::BatchConfig& config, size_t first, size_t count, std::uint8_t* out) {
+        size_t bytes = alone::packedBoardSize(config.size);
+        size_t streams = (count + alone::BatchStream - 1) / alone::BatchStream;
+
+        //у каждого рабочего потока своя карта, чтобы не выделять память на каждую генерацию
+        std::vector <Map> maps(config.threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : config.threads);
+        //в упакованной карте областей нет, поэтому их и не размечаем
+        for (auto& it : maps) {
+            it.regions(false);
+            it.resize(config.size);
+        }
+
+        alone::parallelFor(streams, maps.size(), [&](size_t stream, size_t worker) {
+            auto& map = maps[worker];
+            std::mt19937_64 rng(alone::streamSeed(config.seed, first / alone::BatchStream + stream));
+
+            size_t begin = stream * alone::BatchStream;
+            size_t end = std::min(count, begin + alone::BatchStream);
+            for (size_t i = begin; i != end; i++) {
+                map.generate(config.bombs, config.x, config.y, rng);
+
+                auto board = out + i * bytes;
+                std::memset(board, 0, bytes);
+                for (size_t x = 0; x != config.size; x++)
+                    for (size_t y = 0; y != config.size; y++)
+                        if (map._Content[x][y].second == Type::Bomb)
+                            board[(x + y * config.size) / 8] |= 1 << (x + y * config.size) % 8;
+            }
+        });
+    }
+}
+
+size_t alone::packedBoardSize(size_t size) {
+    return (size * size + 7) / 8;
+}
+
+std::uint64_t alone::streamSeed(std::uint64_t seed, std::uint64_t stream) {
+    std::uint64_t z = seed + (stream + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void alone::generateBoards(const BatchConfig& config, size_t count, std::uint8_t* out) {
+    generateRange(config, 0, count, out);
+}
+
+std::vector <std::uint8_t> alone::generateBoards(const BatchConfig& config, size_t count) {
+    std::vector <std::uint8_t> out(count * packedBoardSize(config.size));
+    generateBoards(config, count, out.data());
+    return out;
+}
+
+bool alone::generateBoards(const BatchConfig& config, size_t count, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    //за раз в памяти лежит не больше одного куска
+    const size_t segment = 256 * BatchStream;
+    size_t bytes = packedBoardSize(config.size);
+    std::vector <std::uint8_t> buffer(std::min(count, segment) * bytes);
+
+    for (size_t first = 0; first < count; first += segment) {
+        size_t part = std::min(segment, count - first);
+        generateRange(config, first, part, buffer.data());
+        file.write((const char*)buffer.data(), part * bytes);
+    }
+
+    return (bool)file;
+}
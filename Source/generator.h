@@ -0,0 +1,76 @@
+#pragma once
+//std
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace alone {
+    /**
+     * параметры пачки карт, которые генерируются заранее
+     */
+    struct BatchConfig {
+        size_t size = 8;
+        size_t bombs = 10;
+
+        /**
+         * клетка первого нажатия, на ней бомбы нет ни на одной карте
+         */
+        size_t x = 0, y = 0;
+
+        /**
+         * главное зерно, от него зависят все карты пачки
+         */
+        std::uint64_t seed = 0;
+
+        /**
+         * 0 - по количеству ядер
+         */
+        size_t threads = 0;
+    };
+
+    /**
+     *  столько карт подряд берут случайные числа из одного потока генератора
+        зерно потока выводится из главного зерна и номера потока,
+        поэтому пачка не зависит ни от количества ядер, ни от того, кто какую часть сгенерировал
+     */
+    constexpr size_t BatchStream = 1024;
+
+    /**
+     * сколько байт занимает одна упакованная карта: один бит на клетку
+     */
+    size_t packedBoardSize(size_t size);
+
+    /**
+     * зерно потока случайных чисел номер stream, выводится из главного через splitmix64
+     */
+    std::uint64_t streamSeed(std::uint64_t seed, std::uint64_t stream);
+
+    /**
+     *  есть ли бомба в клетке упакованной карты
+        клетка (x, y) хранится в бите номер x + y * size, младшие биты идут первыми
+     */
+    inline bool packedHasBomb(const std::uint8_t* board, size_t size, size_t x, size_t y) {
+        size_t bit = x + y * size;
+        return (board[bit / 8] >> (bit % 8)) & 1;
+    }
+
+    /**
+     *  генерирует count карт подряд в непрерывный буфер
+     * @param config
+     * @param count
+     * @param out должен вмещать count * packedBoardSize(config.size) байт
+     */
+    void generateBoards(const BatchConfig& config, size_t count, std::uint8_t* out);
+
+    /**
+     * то же самое, но с возвратом буфера
+     */
+    std::vector <std::uint8_t> generateBoards(const BatchConfig& config, size_t count);
+
+    /**
+     *  генерирует карты прямо в файл, кусками, поэтому вся пачка в памяти не держится
+        содержимое файла совпадает с буфером из generateBoards с теми же параметрами
+     * @return false, если файл не удалось записать
+     */
+    bool generateBoards(const BatchConfig& config, size_t count, const std::string& path);
+}
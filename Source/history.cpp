@@ -0,0 +1,74 @@
+#include "history.h"
+
+namespace {
+    const char States[] = { 'n', 'r', 'f' };
+
+    std::uint32_t code(char state) {
+        return state == 'r' ? 1 : state == 'f' ? 2 : 0;
+    }
+
+    //состояние клетки до хода, в котором она стала state
+    char before(char state) {
+        return state == 'n' ? 'f' : 'n';
+    }
+}
+
+alone::History::History(std::pmr::memory_resource* resource) : _Cells(resource), _Moves(resource) {}
+
+void alone::History::record(const Map& map) {
+    if (map._Dirty.empty())
+        return;
+
+    //новый ход отменяет возможность повтора
+    _Moves.resize(_Position);
+    _Cells.resize(_Moves.empty() ? 0 : _Moves.back());
+
+    for (auto it : map._Dirty)
+        _Cells.push_back((std::uint32_t)it << 2 | code(map._Content.data()[it].first));
+    _Moves.push_back(_Cells.size());
+    _Position++;
+}
+
+bool alone::History::undo(Map& map) {
+    if (_Position == 0)
+        return false;
+
+    //недоделанная заливка относится к последнему ходу, её клетки должны быть открыты до отката
+    map.settle();
+    map._Dirty.clear();
+    size_t begin = _Position == 1 ? 0 : _Moves[_Position - 2], end = _Moves[_Position - 1];
+    for (size_t i = begin; i != end; i++)
+        map._Restore(_Cells[i] >> 2, before(States[_Cells[i] & 3]));
+
+    _Position--;
+    return true;
+}
+
+bool alone::History::redo(Map& map) {
+    if (_Position == _Moves.size())
+        return false;
+
+    map.settle();
+    map._Dirty.clear();
+    size_t begin = _Position == 0 ? 0 : _Moves[_Position - 1], end = _Moves[_Position];
+    for (size_t i = begin; i != end; i++)
+        map._Restore(_Cells[i] >> 2, States[_Cells[i] & 3]);
+
+    _Position++;
+    return true;
+}
+
+void alone::History::clear() {
+    //обмен с пустым вектором гарантированно освобождает память, в отличие от clear
+    decltype(_Cells)(_Cells.get_allocator()).swap(_Cells);
+    decltype(_Moves)(_Moves.get_allocator()).swap(_Moves);
+    _Position = 0;
+}
+
+size_t alone::History::size() const {
+    return _Position;
+}
+
+size_t alone::History::bytes() const {
+    return (_Cells.capacity() + _Moves.capacity()) * sizeof(std::uint32_t);
+}
@@ -0,0 +1,71 @@
+#pragma once
+//std
+#include <vector>
+#include <cstdint>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     *  история ходов для отмены и повтора
+        ход - это список изменившихся клеток из map._Dirty, каждая клетка упакована в 4 байта:
+        номер клетки (x + y * размер) << 2 и новое состояние в двух младших битах
+        старое состояние хранить не нужно, за один ход клетка меняется только так:
+            n -> r при открытии, n -> f и f -> n при флаге
+        поэтому отмена и повтор стоят O(изменённых клеток) без снимков всей карты
+     */
+    class History {
+    public:
+        /**
+         * @param resource откуда брать память под ходы, например арена партии
+         */
+        explicit History(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        /**
+         * записывает ход, который только что сделан на карте; всё, что можно было повторить, забывается
+         */
+        void record(const Map& map);
+
+        /**
+         *  откатывает последний ход, изменённые клетки попадают в map._Dirty
+         * @return false, если отменять нечего
+         */
+        bool undo(Map& map);
+
+        /**
+         * @return false, если повторять нечего
+         */
+        bool redo(Map& map);
+
+        /**
+         * забывает все ходы и отдаёт память ресурсу, после этого арену можно сбросить
+         */
+        void clear();
+
+        /**
+         * сколько ходов можно отменить
+         */
+        size_t size() const;
+
+        /**
+         * сколько байт занимает история
+         */
+        size_t bytes() const;
+
+    private:
+        /**
+         * клетки всех ходов подряд
+         */
+        std::pmr::vector <std::uint32_t> _Cells;
+
+        /**
+         * конец каждого хода в _Cells
+         */
+        std::pmr::vector <std::uint32_t> _Moves;
+
+        /**
+         * сколько ходов сейчас применено, остальные можно повторить
+         */
+        size_t _Position = 0;
+    };
+}
@@ -0,0 +1,301 @@
+#include "map.h"
+
+//std
+#include <limits>
+
+Map::Map(std::pmr::memory_resource* resource) : Engine(alone::topology::Square(0, 0), resource), _Content(resource),
+                                                 _Region(resource), _RegionStart(resource), _RegionCells(resource), _RegionFlags(resource),
+                                                 _RegionCursor(resource),
+                                                 _Fallback(0, 0, resource) {}
+
+void Map::resize(size_t size) {
+    _Content.resize(size, { 'n', Type::None });
+    _Shape = alone::topology::Square(size, size);
+    _Lazy = false;
+    _Reset();
+
+    //до генерации областей нет, открытие идёт обычной заливкой
+    _Unlabel();
+}
+
+void Map::generate(size_t bombs, size_t x, size_t y, std::mt19937_64& rng) {
+    size_t size = _Content.size();
+
+    //клетка под первым нажатием всегда без бомбы, поэтому бомб не больше, чем остальных клеток
+    _Bombs = std::min(bombs, size * size == 0 ? 0 : size * size - 1);
+    _Lazy = _NumbersMode == Numbers::Lazy || (_NumbersMode == Numbers::Auto && size * size > LazyCells);
+
+    //карта может генерироваться повторно, поэтому сначала всё очищаем, вместе с недоделанной заливкой
+    _Reset();
+    _Content.fill({ 'n', _Lazy ? Type::Unknown : Type::None });
+
+    if (_Lazy) {
+        //алгоритм Флойда: bombs номеров из всех клеток, кроме первой, занятость проверяется по самой карте
+        //номера от первой клетки и дальше сдвигаются на один
+        size_t first = x + y * size, cells = size * size - 1;
+        auto place = [&](size_t i) {
+            auto& type = _Content.data()[i < first ? i : i + 1].second;
+            if (type == Type::Bomb)
+                return false;
+            type = Type::Bomb;
+            return true;
+        };
+        for (size_t j = cells - _Bombs; j != cells; j++)
+            if (!place(rng() % (j + 1)))
+                place(j);
+
+        _Unlabel();
+        return;
+    }
+
+    //заполнение бомб частичным перемешиванием всех клеток, кроме той, в которую нажал игрок
+    //элемент с индексом 10 при ширине в 8 тайлов - это элемент с 'x = 2' и 'y = 1'
+    size_t placed = _Scatter(x + y * size, rng);
+    for (size_t i = 0; i != placed; i++)
+        _Content.data()[_Unfilled[i]] = { 'n', Type::Bomb };
+
+    //заполнение чиселок вокруг бомб: размеры уровней собраны отдельно, остальные считаются общим кодом
+    switch (size) {
+        case 8:
+            _Numbers(alone::Board <8, 8>());
+            break;
+        case 10:
+            _Numbers(alone::Board <10, 10>());
+            break;
+        case 20:
+            _Numbers(alone::Board <20, 20>());
+            break;
+        default:
+            _Fallback.resize(size, size);
+            _Numbers(_Fallback);
+    }
+
+    if (_Labelled)
+        _Label();
+    else
+        _Unlabel();
+}
+
+template <class _Board>
+void Map::_Numbers(_Board&& board) {
+    size_t size = _Content.size();
+    for (size_t i = 0; i != _Bombs && i != _Unfilled.size(); i++)
+        board.place(_Unfilled[i] % size, _Unfilled[i] / size);
+
+    for (size_t y = 0; y != size; y++)
+        for (size_t x = 0; x != size; x++) {
+            if (board.mine(x, y))
+                continue;
+
+            size_t value = board.around(x, y);
+            if (value != 0)
+                _Content[x][y].second = (Type)(value - 1);
+        }
+}
+
+void Map::_Label() {
+    size_t size = _Content.size(), cells = size * size;
+    auto data = _Content.data();
+    auto empty = [&](size_t i) { return data[i].second == Type::None; };
+
+    //сначала _Region - это лес множеств: каждая пустая клетка указывает на родителя
+    _Region.assign(cells, NoRegion);
+    auto find = [&](std::uint32_t i) {
+        while (_Region[i] != i) {
+            _Region[i] = _Region[_Region[i]];
+            i = _Region[i];
+        }
+        return i;
+    };
+    auto unite = [&](std::uint32_t a, std::uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+            _Region[std::max(a, b)] = std::min(a, b);
+    };
+
+    //достаточно уже пройденных соседей: слева, слева сверху, сверху и справа сверху
+    for (size_t y = 0; y != size; y++)
+        for (size_t x = 0; x != size; x++) {
+            size_t i = x + y * size;
+            if (!empty(i))
+                continue;
+
+            _Region[i] = i;
+            if (x != 0 && empty(i - 1))
+                unite(i, i - 1);
+            if (y != 0) {
+                if (x != 0 && empty(i - size - 1))
+                    unite(i, i - size - 1);
+                if (empty(i - size))
+                    unite(i, i - size);
+                if (x + 1 != size && empty(i - size + 1))
+                    unite(i, i - size + 1);
+            }
+        }
+
+    //родитель всегда раньше клетки, а корень - самая ранняя клетка множества,
+    //поэтому за один проход по порядку корень получает новый номер, а остальные - уже готовый номер родителя
+    std::uint32_t regions = 0;
+    for (size_t i = 0; i != cells; i++) {
+        if (_Region[i] == NoRegion)
+            continue;
+        _Region[i] = _Region[i] == i ? regions++ : _Region[_Region[i]];
+    }
+
+    //списки областей: размеры, сдвиги, заполнение
+    //число на границе может касаться нескольких областей и попадает в каждую
+    auto forBorders = [&](auto&& visit) {
+        for (size_t y = 0; y != size; y++)
+            for (size_t x = 0; x != size; x++) {
+                size_t i = x + y * size;
+                if (empty(i) || data[i].second == Type::Bomb)
+                    continue;
+
+                std::uint32_t seen[4];
+                size_t count = 0;
+                for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < size; j++)
+                    for (size_t k = x == 0 ? 0 : x - 1; k <= x + 1 && k < size; k++) {
+                        auto r = _Region[k + j * size];
+                        if (r != NoRegion && std::find(seen, seen + count, r) == seen + count) {
+                            seen[count++] = r;
+                            visit(r, i);
+                        }
+                    }
+            }
+    };
+
+    _RegionStart.assign(regions + 1, 0);
+    for (size_t i = 0; i != cells; i++)
+        if (_Region[i] != NoRegion)
+            _RegionStart[_Region[i] + 1]++;
+    forBorders([&](std::uint32_t r, size_t) { _RegionStart[r + 1]++; });
+    for (size_t r = 0; r != regions; r++)
+        _RegionStart[r + 1] += _RegionStart[r];
+
+    _RegionCells.resize(_RegionStart.back());
+    //_Unfilled не трогаем: там список бомб текущей карты
+    _RegionCursor.assign(_RegionStart.begin(), _RegionStart.end() - 1);
+    for (size_t i = 0; i != cells; i++)
+        if (_Region[i] != NoRegion)
+            _RegionCells[_RegionCursor[_Region[i]]++] = i;
+    forBorders([&](std::uint32_t r, size_t i) { _RegionCells[_RegionCursor[r]++] = i; });
+
+    _RegionFlags.assign(regions, 0);
+}
+
+void Map::_Unlabel() {
+    _Region.clear();
+    _RegionStart.clear();
+    _RegionCells.clear();
+    _RegionFlags.clear();
+}
+
+void Map::numbers(Numbers mode) {
+    _NumbersMode = mode;
+}
+
+void Map::regions(bool enabled) {
+    _Labelled = enabled;
+}
+
+bool Map::lazy() const {
+    return _Lazy;
+}
+
+Type Map::_Settle(size_t index) {
+    auto& type = _Content.data()[index].second;
+    if (type == Type::Unknown) {
+        size_t size = _Content.size(), value = _DetectAround(index % size, index / size);
+        type = value == 0 ? Type::None : (Type)(value - 1);
+    }
+    return type;
+}
+
+void Map::generate(size_t bombs, size_t x, size_t y) {
+    std::mt19937_64 rng(std::random_device{}());
+    generate(bombs, x, y, rng);
+}
+
+bool Map::_HasBomb(size_t x, size_t y) {
+    if (x >= _Content.size() || y >= _Content.size())
+        return false;
+    return _Content[x][y].second == Type::Bomb;
+}
+
+size_t Map::_DetectAround(size_t x, size_t y) {
+    return _HasBomb(x - 1, y - 1) + _HasBomb(x, y - 1) + _HasBomb(x + 1, y - 1) +
+           _HasBomb(x - 1, y) + _HasBomb(x + 1, y) +
+           _HasBomb(x - 1, y + 1) + _HasBomb(x, y + 1) + _HasBomb(x + 1, y + 1);
+}
+
+bool Map::reveal(size_t x, size_t y) {
+    return _Reveal(x + y * _Content.size());
+}
+
+bool Map::flag(size_t x, size_t y) {
+    return _Flag(x + y * _Content.size());
+}
+
+bool Map::chord(size_t x, size_t y) {
+    return _Chord(x + y * _Content.size());
+}
+
+bool Map::revealSliced(size_t x, size_t y) {
+    return _RevealSliced(x + y * _Content.size());
+}
+
+std::uint8_t Map::visible(size_t index) const {
+    auto& cell = _Content.data()[index];
+    if (cell.first == 'r')
+        return (std::uint8_t)cell.second;
+    if (cell.first == 'f')
+        return (std::uint8_t)Type::Flag;
+    return (std::uint8_t)Type::Unknown;
+}
+
+size_t Map::openings() const {
+    return _RegionFlags.size();
+}
+
+std::span <const std::uint32_t> Map::region(size_t region) const {
+    return { _RegionCells.data() + _RegionStart[region], _RegionCells.data() + _RegionStart[region + 1] };
+}
+
+std::uint32_t Map::regionOf(size_t index) const {
+    return _Region.empty() ? NoRegion : _Region[index];
+}
+
+char& Map::_State(size_t index) {
+    return _Content.data()[index].first;
+}
+
+std::uint8_t Map::_Around(size_t index) {
+    auto type = _Settle(index);
+    if (type == Type::Bomb)
+        return Mine;
+    return type == Type::None ? 0 : (std::uint8_t)type + 1;
+}
+
+bool Map::_Mine(size_t index) const {
+    return _Content.data()[index].second == Type::Bomb;
+}
+
+void Map::_Flagged(size_t index, int delta) {
+    auto r = regionOf(index);
+    if (r != NoRegion)
+        _RegionFlags[r] += delta;
+}
+
+bool Map::_OpenArea(size_t index) {
+    //пустая клетка размеченной области без флагов внутри открывает готовый список целиком
+    auto r = regionOf(index);
+    if (r == NoRegion || _RegionFlags[r] != 0)
+        return false;
+
+    //в области только пустые клетки и числа, бомб там не бывает
+    for (auto i : region(r))
+        if (_Content.data()[i].first == 'n')
+            _Open(i);
+    return true;
+}
@@ -0,0 +1,357 @@
+#pragma once
+//std
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+#include <span>
+#include <chrono>
+#include <limits>
+
+#include "topology.h"
+#include "board.h"
+
+/**
+ *  квадратная матрица одним куском памяти, строка за строкой: клетка (x, y) лежит по индексу x + y * size
+    обращение grid[x][y] осталось таким же, как у вектора векторов
+    память берётся из переданного ресурса, копия матрицы всегда живёт в обычной куче
+ */
+template <class _T>
+class Grid {
+public:
+    explicit Grid(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : _Content(resource) {}
+
+    /**
+     * столбец матрицы, просто указатель с шагом в одну строку
+     */
+    template <class _U>
+    class Column {
+    public:
+        Column(_U* data, size_t size) : _Data(data), _Size(size) {}
+
+        _U& operator[](size_t y) const {
+            return _Data[y * _Size];
+        }
+
+        size_t size() const {
+            return _Size;
+        }
+
+    private:
+        _U* _Data;
+        size_t _Size;
+    };
+
+    void resize(size_t size, const _T& value) {
+        _Size = size;
+        _Content.assign(size * size, value);
+    }
+
+    void fill(const _T& value) {
+        std::fill(_Content.begin(), _Content.end(), value);
+    }
+
+    size_t size() const {
+        return _Size;
+    }
+
+    Column <_T> operator[](size_t x) {
+        return Column <_T>(_Content.data() + x, _Size);
+    }
+
+    Column <const _T> operator[](size_t x) const {
+        return Column <const _T>(_Content.data() + x, _Size);
+    }
+
+    _T* data() {
+        return _Content.data();
+    }
+
+    const _T* data() const {
+        return _Content.data();
+    }
+
+    bool operator==(const Grid& other) const = default;
+
+private:
+    std::pmr::vector <_T> _Content;
+    size_t _Size = 0;
+};
+
+/**
+ *  это для удобной нумерации текстурок
+    один байт, чтобы клетка карты занимала два байта и её можно было обрабатывать векторными инструкциями
+ */
+enum class Type : std::uint8_t {
+    /**
+     * кол-во бомб от 1 до 8
+     */
+    Number1 = 0,
+    Number2 = 1,
+    Number3,
+    Number4,
+    Number5,
+    Number6,
+    Number7,
+    Number8,
+
+    /**
+     * бомб нет
+     */
+    None,
+
+    /**
+     * неизвестно что тут
+     */
+    Unknown,
+
+    /**
+     * флажок, если бомба тут есть
+     */
+    Flag,
+
+    /**
+     * бомбы нет
+     */
+    NoBomb,
+
+    /**
+     * нет ничего
+     */
+    NoneQuiestion,
+
+    /**
+     * неизвестно и вопрос
+     */
+    UnknownQuestion,
+
+    /**
+     * тут бомба
+     */
+    Bomb,
+
+    /**
+     * бомба взорвалась
+     */
+    RedBomb
+};
+
+/**
+ *  класс карты игры
+    ничего не знает ни про sfml, ни про уровни сложности, поэтому его можно гонять без окна
+    ходы и счётчики - общее ядро alone::Engine на квадратной топологии, здесь только хранение клеток,
+    генерация с числами в Type, ленивые числа и готовые пустые области
+ */
+class Map : public alone::Engine <Map, alone::topology::Square> {
+    friend Engine;
+
+public:
+    /**
+     * @param resource откуда брать память под поле, изменения и рабочие массивы, например арена партии
+     */
+    explicit Map(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /**
+     * изменение размера квадратной карты
+     * @param size размер грани
+     */
+    void resize(size_t size);
+
+    /**
+     *  генерация карты, включая рандомное заполнение
+        (x, y) - это точка, в которую нажал игрок, там бомбы не будет
+        одинаковый генератор всегда даёт одинаковую карту
+     * @param bombs
+     * @param x
+     * @param y
+     * @param rng
+     */
+    void generate(size_t bombs, size_t x, size_t y, std::mt19937_64& rng);
+
+    /**
+     * то же самое, но со случайным зерном
+     */
+    void generate(size_t bombs, size_t x, size_t y);
+
+    /**
+     *  когда считать числа вокруг бомб
+        Eager - все сразу при генерации, вместе с разметкой пустых областей
+        Lazy - при первом открытии клетки, до этого в ней лежит Type::Unknown;
+            бомбы ставятся алгоритмом Флойда, и генерация стоит O(бомбы) вместо O(клетки),
+            зато областей нет и открытие идёт обычной заливкой
+        Auto - Lazy для карт больше LazyCells клеток, иначе Eager
+        на одинаковом зерне Eager и Lazy дают разные карты
+     */
+    enum class Numbers {
+        Auto,
+        Eager,
+        Lazy
+    };
+
+    static constexpr size_t LazyCells = 1 << 16;
+
+    /**
+     * режим для следующих генераций
+     */
+    void numbers(Numbers mode);
+
+    /**
+     *  размечать ли пустые области при следующих генерациях, по умолчанию да
+        без разметки открытие идёт обычной заливкой, а генерация не тратит время на разметку,
+        это нужно тем, кто области не смотрит: пакетной генерации и среде для обучения
+     */
+    void regions(bool enabled);
+
+    /**
+     * числа текущей карты считаются при открытии
+     */
+    bool lazy() const;
+
+    /**
+     *  открывает закрытую клетку, как при нажатии левой кнопкой мыши
+        если клетка пустая, то открываются и соседи
+     * @return true, если в клетке бомба
+     */
+    bool reveal(size_t x, size_t y);
+
+    /**
+     *  ставит флаг на закрытую клетку или снимает его
+     * @return true, если флаг поставлен
+     */
+    bool flag(size_t x, size_t y);
+
+    /**
+     *  аккорд: если вокруг открытого числа стоит ровно столько флагов, сколько это число,
+        открываются все остальные закрытые соседи
+        все соседи открываются одной заливкой, изменения лежат в одном _Dirty
+     * @return true, если среди открытых соседей оказалась бомба
+     */
+    bool chord(size_t x, size_t y);
+
+    /**
+     *  открытие по частям, чтобы большая заливка не останавливала кадр
+        сразу открывается только сама клетка, остальное - в advance, волной от неё
+        любой следующий ход (reveal, flag, chord, generate) сначала доделывает заливку,
+        поэтому ходы всегда применяются к тому же итогу, что и у обычного reveal
+        пока заливка идёт, visible, счётчики, won и lost показывают только уже открытые клетки,
+        поэтому итог партии можно проверять только после settle или когда pending() вернёт false
+        заливка по частям идёт волной по соседям и не открывает готовые области целиком,
+        поэтому игра зовёт её только для ленивых карт, а размеченные открывает обычным reveal
+     * @return true, если в клетке бомба
+     */
+    bool revealSliced(size_t x, size_t y);
+
+    /**
+     *  то, что видит игрок в клетке с номером x + y * размер, одним байтом из Type:
+        открытая клетка - число, None или Bomb, закрытая - Unknown, с флагом - Flag
+     */
+    std::uint8_t visible(size_t index) const;
+
+    /**
+     *  пустые области (openings) размечаются один раз при генерации
+        область - это связная группа пустых клеток вместе с числами на её границе,
+        нажатие на пустую клетку открывает готовый список области вместо заливки
+     */
+    static constexpr std::uint32_t NoRegion = UINT32_MAX;
+
+    /**
+     * количество пустых областей на карте
+     */
+    size_t openings() const;
+
+    /**
+     * номера клеток области: сначала её пустые клетки, потом числа на границе
+     */
+    std::span <const std::uint32_t> region(size_t region) const;
+
+    /**
+     * номер области пустой клетки или NoRegion
+     */
+    std::uint32_t regionOf(size_t index) const;
+
+    /**
+     *  костыль из использования char'а как состояния для отрисовки
+        n - unknown, r - revealed, f - flag
+     */
+    Grid <std::pair <char, Type>> _Content;
+
+    /**
+     *  проверяет, есть ли бомба по заданному индексу
+        если выходит индекс за пределы карты, то возвращает false
+     */
+    bool _HasBomb(size_t x, size_t y);
+
+    /**
+     * проверяет все клетки сверху, снизу, по бокам и по диагонали
+     */
+    size_t _DetectAround(size_t x, size_t y);
+
+    /**
+     *  разметка пустых областей системой непересекающихся множеств за один проход по карте,
+        потом списки областей в сжатом виде: _RegionStart[r].._RegionStart[r + 1] в _RegionCells
+     */
+    void _Label();
+
+    /**
+     * убирает разметку, открытие снова идёт обычной заливкой
+     */
+    void _Unlabel();
+
+    /**
+     *  числа вокруг бомб из первых _Bombs клеток _Unfilled
+        board - бомбы с рамкой из board.h, для размеров уровней её размер известен при сборке
+     */
+    template <class _Board>
+    void _Numbers(_Board&& board);
+
+    /**
+     *  содержимое клетки с номером index; в ленивом режиме число считается здесь и остаётся в клетке
+     */
+    Type _Settle(size_t index);
+
+private:
+    /**
+     * область каждой клетки, для чисел и бомб - NoRegion
+     */
+    std::pmr::vector <std::uint32_t> _Region;
+    std::pmr::vector <std::uint32_t> _RegionStart;
+    std::pmr::vector <std::uint32_t> _RegionCells;
+
+    /**
+     *  сколько пустых клеток области стоит под флагом
+        флаг внутри области разрывает заливку, тогда область открывается обычной заливкой, как и раньше
+     */
+    std::pmr::vector <std::uint32_t> _RegionFlags;
+
+    /**
+     * куда _Label пишет следующую клетку каждой области, переиспользуется между генерациями
+     */
+    std::pmr::vector <std::uint32_t> _RegionCursor;
+
+    /**
+     * бомбы с рамкой для размеров, которые не собраны отдельно, переиспользуется между генерациями
+     */
+    alone::Board <alone::DynamicSize, alone::DynamicSize> _Fallback;
+
+    /**
+     * клетки для Engine, клетка index - это _Content.data()[index]
+     */
+    char& _State(size_t index);
+    std::uint8_t _Around(size_t index);
+    bool _Mine(size_t index) const;
+
+    /**
+     * открывает все закрытые клетки готовой области пустой клетки, если в области нет флагов
+     */
+    bool _OpenArea(size_t index);
+
+    /**
+     * добавляет или убирает флаг из счётчика области клетки
+     */
+    void _Flagged(size_t index, int delta);
+
+    Numbers _NumbersMode = Numbers::Auto;
+    bool _Lazy = false, _Labelled = true;
+};
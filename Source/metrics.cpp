@@ -0,0 +1,127 @@
+#include "metrics.h"
+#include "generator.h"
+#include "parallel.h"
+
+alone::BoardMetrics alone::Metrics::measure(const Map& map) {
+    //числа берутся от бомб, а не из клеток: в ленивом режиме закрытые клетки ещё не посчитаны
+    auto content = map._Content.data();
+    return _Count(map._Content.size(), [&](size_t i) { return content[i].second == Type::Bomb; });
+}
+
+alone::BoardMetrics alone::Metrics::measure(const std::uint8_t* board, size_t size) {
+    return _Count(size, [&](size_t i) { return packedHasBomb(board, size, i % size, i / size); });
+}
+
+template <class _HasBomb>
+alone::BoardMetrics alone::Metrics::_Count(size_t size, _HasBomb&& bomb) {
+    _Cells.assign(size * size, 0);
+
+    //бомба добавляет единицу всем соседям, сами бомбы помечаются после
+    for (size_t y = 0; y != size; y++)
+        for (size_t x = 0; x != size; x++) {
+            if (!bomb(x + y * size))
+                continue;
+            for (size_t j = y == 0 ? 0 : y - 1; j <= std::min(y + 1, size - 1); j++)
+                for (size_t i = x == 0 ? 0 : x - 1; i <= std::min(x + 1, size - 1); i++)
+                    _Cells[i + j * size]++;
+        }
+
+    for (size_t i = 0; i != _Cells.size(); i++)
+        if (bomb(i))
+            _Cells[i] = Mine;
+
+    return _Score(size);
+}
+
+alone::BoardMetrics alone::Metrics::_Score(size_t size) {
+    BoardMetrics result;
+    _Parent.assign(size * size, NoSet);
+
+    for (size_t y = 0; y != size; y++)
+        for (size_t x = 0; x != size; x++) {
+            std::uint32_t index = x + y * size;
+            auto cell = _Cells[index];
+            if (cell == Mine) {
+                result.mines++;
+                continue;
+            }
+
+            //число на границе области открывается вместе с ней и в 3BV не входит
+            bool empty = cell == 0, island = !empty;
+            for (size_t j = y == 0 ? 0 : y - 1; j <= std::min(y + 1, size - 1) && island; j++)
+                for (size_t i = x == 0 ? 0 : x - 1; i <= std::min(x + 1, size - 1); i++)
+                    if (_Cells[i + j * size] == 0) {
+                        island = false;
+                        break;
+                    }
+            if (!empty && !island)
+                continue;
+            //каждое отдельное число - это одно нажатие, острова считаются группами
+            if (island)
+                result.bbbv++;
+
+            _Parent[index] = index;
+            size_t& groups = empty ? result.openings : result.islands;
+            groups++;
+
+            //соседи слева и сверху уже пройдены, клетки одного вида объединяются
+            auto join = [&](size_t i, size_t j) {
+                std::uint32_t other = i + j * size;
+                if (_Parent[other] != NoSet && (_Cells[other] == 0) == empty && _Union(index, other))
+                    groups--;
+            };
+            if (x != 0)
+                join(x - 1, y);
+            if (y != 0) {
+                if (x != 0)
+                    join(x - 1, y - 1);
+                join(x, y - 1);
+                if (x + 1 != size)
+                    join(x + 1, y - 1);
+            }
+        }
+
+    result.bbbv += result.openings;
+    result.density = size == 0 ? 0 : (double)result.mines / (size * size);
+    return result;
+}
+
+std::uint32_t alone::Metrics::_Find(std::uint32_t index) {
+    while (_Parent[index] != index) {
+        _Parent[index] = _Parent[_Parent[index]];
+        index = _Parent[index];
+    }
+    return index;
+}
+
+bool alone::Metrics::_Union(std::uint32_t lhs, std::uint32_t rhs) {
+    lhs = _Find(lhs);
+    rhs = _Find(rhs);
+    if (lhs == rhs)
+        return false;
+    _Parent[std::max(lhs, rhs)] = std::min(lhs, rhs);
+    return true;
+}
+
+alone::BoardMetrics alone::measure(const Map& map) {
+    return Metrics().measure(map);
+}
+
+void alone::measureBoards(const std::uint8_t* boards, size_t size, size_t count, BoardMetrics* out, size_t threads) {
+    size_t bytes = packedBoardSize(size);
+    size_t chunks = (count + BatchStream - 1) / BatchStream;
+
+    //задача - кусок карт, а не одна карта, чтобы не брать блокировку на каждую
+    std::vector <Metrics> workers(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads);
+    parallelFor(chunks, workers.size(), [&](size_t chunk, size_t worker) {
+        size_t end = std::min(count, (chunk + 1) * BatchStream);
+        for (size_t i = chunk * BatchStream; i != end; i++)
+            out[i] = workers[worker].measure(boards + i * bytes, size);
+    });
+}
+
+std::vector <alone::BoardMetrics> alone::measureBoards(const std::vector <std::uint8_t>& boards, size_t size, size_t threads) {
+    std::vector <BoardMetrics> out(boards.size() / packedBoardSize(size));
+    measureBoards(boards.data(), size, out.size(), out.data(), threads);
+    return out;
+}
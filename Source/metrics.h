@@ -0,0 +1,98 @@
+#pragma once
+//std
+#include <vector>
+#include <cstdint>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     *  сложность карты
+        3BV - минимальное количество нажатий, чтобы открыть карту без флагов:
+        по одному на каждую пустую область и на каждое число, которое не лежит на границе области
+     */
+    struct BoardMetrics {
+        size_t bbbv = 0;
+
+        /**
+         * пустые области, одно нажатие открывает всю область
+         */
+        size_t openings = 0;
+
+        /**
+         * связные группы чисел, которые не открываются ни одной областью
+         */
+        size_t islands = 0;
+
+        size_t mines = 0;
+
+        /**
+         * доля клеток с бомбами
+         */
+        double density = 0;
+    };
+
+    /**
+     *  считает метрики за один проход по клеткам строка за строкой
+        области и острова собираются системой непересекающихся множеств по уже пройденным соседям,
+        поэтому каждая клетка читается один раз, а рабочие массивы переиспользуются между картами
+     */
+    class Metrics {
+    public:
+        BoardMetrics measure(const Map& map);
+
+        /**
+         * то же для упакованной карты из generateBoards
+         */
+        BoardMetrics measure(const std::uint8_t* board, size_t size);
+
+    private:
+        /**
+         * в клетке бомба, иначе в _Cells лежит количество бомб вокруг
+         */
+        static constexpr std::uint8_t Mine = 9;
+
+        /**
+         * клетка не входит ни в область, ни в остров
+         */
+        static constexpr std::uint32_t NoSet = UINT32_MAX;
+
+        std::vector <std::uint8_t> _Cells;
+        std::vector <std::uint32_t> _Parent;
+
+        /**
+         * заполняет _Cells по тому, где бомбы, и считает метрики
+         */
+        template <class _HasBomb>
+        BoardMetrics _Count(size_t size, _HasBomb&& bomb);
+
+        BoardMetrics _Score(size_t size);
+
+        std::uint32_t _Find(std::uint32_t index);
+
+        /**
+         * @return true, если множества были разными
+         */
+        bool _Union(std::uint32_t lhs, std::uint32_t rhs);
+    };
+
+    /**
+     * метрики одной карты
+     */
+    BoardMetrics measure(const Map& map);
+
+    /**
+     *  метрики пачки упакованных карт по потокам, у каждого потока свои рабочие массивы
+     * @param boards count карт по packedBoardSize(size) байт подряд
+     * @param size
+     * @param count
+     * @param out должен вмещать count метрик
+     * @param threads 0 - по количеству ядер
+     */
+    void measureBoards(const std::uint8_t* boards, size_t size, size_t count, BoardMetrics* out, size_t threads = 0);
+
+    /**
+     * то же самое, но с возвратом результата
+     */
+    std::vector <BoardMetrics> measureBoards(const std::vector <std::uint8_t>& boards, size_t size, size_t threads = 0);
+}
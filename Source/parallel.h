@@ -0,0 +1,155 @@
+#pragma once
+//std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <memory>
+
+namespace alone {
+    /**
+     *  потоки, которые живут между вызовами run, чтобы частые маленькие задачи не платили за создание потоков
+        вызывающий поток работает вместе с пулом как поток номер 0
+        каждый поток сначала получает свой непрерывный кусок задач и берёт их с начала,
+        а закончив, ворует задачи с конца чужих кусков
+        какой поток выполнит задачу - не определено, поэтому результат задачи должен зависеть только от её номера
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @param threads количество потоков вместе с вызывающим, 0 - по количеству ядер
+         */
+        explicit ThreadPool(size_t threads = 0) {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            _Ranges.reset(new Range[threads]);
+            _Threads = threads;
+
+            for (size_t i = 1; i < threads; i++)
+                _Workers.emplace_back([this, i] { _Loop(i); });
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard lock(_Mutex);
+                _Stop = true;
+            }
+            _Wake.notify_all();
+            for (auto& it : _Workers)
+                it.join();
+        }
+
+        size_t size() const {
+            return _Threads;
+        }
+
+        /**
+         *  выполняет task(номер задачи, номер потока) для всех задач от 0 до count и ждёт их
+            вызывать из одного потока за раз
+         */
+        void run(size_t count, const std::function <void(size_t, size_t)>& task) {
+            if (count == 0)
+                return;
+
+            for (size_t i = 0; i != _Threads; i++) {
+                _Ranges[i].begin = count * i / _Threads;
+                _Ranges[i].end = count * (i + 1) / _Threads;
+            }
+
+            {
+                std::lock_guard lock(_Mutex);
+                _Task = &task;
+                _Count = count;
+                _Busy = _Threads - 1;
+                _Generation++;
+            }
+            _Wake.notify_all();
+
+            _Work(0);
+
+            std::unique_lock lock(_Mutex);
+            _Done.wait(lock, [this] { return _Busy == 0; });
+            _Task = nullptr;
+        }
+
+    private:
+        struct Range {
+            std::mutex mutex;
+            size_t begin = 0, end = 0;
+        };
+
+        void _Loop(size_t self) {
+            size_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock lock(_Mutex);
+                    _Wake.wait(lock, [&] { return _Stop || _Generation != seen; });
+                    if (_Stop)
+                        return;
+                    seen = _Generation;
+                }
+
+                _Work(self);
+
+                std::lock_guard lock(_Mutex);
+                if (--_Busy == 0)
+                    _Done.notify_one();
+            }
+        }
+
+        void _Work(size_t self) {
+            while (true) {
+                size_t job = _Count;
+
+                {
+                    std::lock_guard lock(_Ranges[self].mutex);
+                    if (_Ranges[self].begin != _Ranges[self].end)
+                        job = _Ranges[self].begin++;
+                }
+
+                //свои задачи кончились, идём воровать у соседей
+                for (size_t i = 1; i != _Threads && job == _Count; i++) {
+                    auto& victim = _Ranges[(self + i) % _Threads];
+                    std::lock_guard lock(victim.mutex);
+                    if (victim.begin != victim.end)
+                        job = --victim.end;
+                }
+
+                if (job == _Count)
+                    return;
+                (*_Task)(job, self);
+            }
+        }
+
+        size_t _Threads;
+        std::unique_ptr <Range[]> _Ranges;
+        std::vector <std::thread> _Workers;
+
+        std::mutex _Mutex;
+        std::condition_variable _Wake, _Done;
+        const std::function <void(size_t, size_t)>* _Task = nullptr;
+        size_t _Count = 0;
+        size_t _Busy = 0;
+        size_t _Generation = 0;
+        bool _Stop = false;
+    };
+
+    /**
+     *  разовый запуск: пул на время одного вызова, для редких больших пачек задач
+        то, что вызывается часто, должно держать свой ThreadPool
+     * @param count количество задач
+     * @param threads количество потоков, 0 - по количеству ядер
+     * @param task
+     */
+    inline void parallelFor(size_t count, size_t threads, const std::function <void(size_t, size_t)>& task) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        ThreadPool pool(std::max <size_t>(1, std::min(threads, count)));
+        pool.run(count, task);
+    }
+}
@@ -0,0 +1,223 @@
+#include "recorder.h"
+
+//std
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+
+//sfml
+#include <SFML/OpenGL.hpp>
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+namespace {
+    //функции PBO из OpenGL 2.1: в gl.h их нет, поэтому они берутся у драйвера через активный контекст sfml
+    struct PixelBuffers {
+        void (APIENTRY* genBuffers)(GLsizei, GLuint*) = nullptr;
+        void (APIENTRY* deleteBuffers)(GLsizei, const GLuint*) = nullptr;
+        void (APIENTRY* bindBuffer)(GLenum, GLuint) = nullptr;
+        void (APIENTRY* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum) = nullptr;
+        void* (APIENTRY* mapBuffer)(GLenum, GLenum) = nullptr;
+        GLboolean (APIENTRY* unmapBuffer)(GLenum) = nullptr;
+
+        bool load() {
+            auto get = [](auto& function, const char* name) {
+                function = reinterpret_cast <std::remove_reference_t <decltype(function)>>(sf::Context::getFunction(name));
+                return function != nullptr;
+            };
+            return get(genBuffers, "glGenBuffers") && get(deleteBuffers, "glDeleteBuffers") && get(bindBuffer, "glBindBuffer") &&
+                   get(bufferData, "glBufferData") && get(mapBuffer, "glMapBuffer") && get(unmapBuffer, "glUnmapBuffer");
+        }
+    } gl;
+}
+
+alone::FrameSink::FrameSink(std::string path, Format format, size_t capacity) {
+    _Path = std::move(path);
+    _Format = format;
+    _Capacity = capacity;
+
+    if (_Format == Raw) {
+        _Raw.open(_Path, std::ios::binary);
+        if (!_Raw)
+            std::cerr << "failed to open " << _Path << '\n';
+    }
+
+    _Worker = std::thread(&FrameSink::_Run, this);
+}
+
+alone::FrameSink::~FrameSink() {
+    {
+        std::lock_guard lock(_Mutex);
+        _Stop = true;
+    }
+    _Wake.notify_one();
+    _Worker.join();
+}
+
+bool alone::FrameSink::push(sf::Image frame) {
+    {
+        std::lock_guard lock(_Mutex);
+        if (_Queue.size() >= _Capacity) {
+            _Dropped++;
+            return false;
+        }
+        _Queue.push_back(std::move(frame));
+    }
+    _Wake.notify_one();
+    return true;
+}
+
+bool alone::FrameSink::full() const {
+    std::lock_guard lock(_Mutex);
+    return _Queue.size() >= _Capacity;
+}
+
+void alone::FrameSink::drop() {
+    _Dropped++;
+}
+
+size_t alone::FrameSink::written() const {
+    return _Written;
+}
+
+size_t alone::FrameSink::dropped() const {
+    return _Dropped;
+}
+
+void alone::FrameSink::_Run() {
+    while (true) {
+        sf::Image frame;
+        {
+            std::unique_lock lock(_Mutex);
+            _Wake.wait(lock, [this] { return _Stop || !_Queue.empty(); });
+
+            //при остановке сначала дописываем очередь
+            if (_Queue.empty())
+                return;
+            frame = std::move(_Queue.front());
+            _Queue.pop_front();
+        }
+
+        auto size = frame.getSize();
+        if (_Format == Raw) {
+            _Raw.write((const char*)frame.getPixelsPtr(), (std::streamsize)size.x * size.y * 4);
+        } else {
+            char number[16];
+            std::snprintf(number, sizeof(number), "%06zu.png", _Written.load() + 1);
+            frame.saveToFile(_Path + number);
+        }
+        _Written++;
+    }
+}
+
+bool alone::Recorder::start(unsigned width, unsigned height, const std::string& path, FrameSink::Format format, size_t every) {
+    stop();
+    if (!_Buffer.create(width, height))
+        return false;
+
+    _Sink = std::make_unique <FrameSink>(path, format);
+    _Every = every == 0 ? 1 : every;
+    _Frame = 0;
+
+    //буферы создаются в контексте закадрового буфера, там же потом и читаются
+    _Next = 0;
+    _Pending = false;
+    if (_Buffer.setActive(true) && gl.load()) {
+        gl.genBuffers(2, _Pbo);
+        for (auto it : _Pbo) {
+            gl.bindBuffer(GL_PIXEL_PACK_BUFFER, it);
+            gl.bufferData(GL_PIXEL_PACK_BUFFER, (std::ptrdiff_t)width * height * 4, nullptr, GL_STREAM_READ);
+        }
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    return true;
+}
+
+void alone::Recorder::stop() {
+    if (!_Sink)
+        return;
+
+    //последний прочитанный кадр ещё лежит в буфере
+    if (_Pbo[0] != 0 && _Buffer.setActive(true)) {
+        if (_Pending)
+            _Collect(_Next ^ 1);
+        gl.deleteBuffers(2, _Pbo);
+    }
+    _Pbo[0] = _Pbo[1] = 0;
+    _Pending = false;
+
+    if (_Sink->dropped() != 0)
+        std::cerr << "recorder dropped " << _Sink->dropped() << " frames\n";
+    _Sink.reset();
+}
+
+bool alone::Recorder::recording() const {
+    return _Sink != nullptr;
+}
+
+void alone::Recorder::capture(const sf::Drawable& scene, const sf::View& view) {
+    if (!_Sink || _Frame++ % _Every != 0)
+        return;
+
+    //кадр всё равно некуда положить, поэтому его не рисуем и не читаем
+    if (_Sink->full()) {
+        _Sink->drop();
+        return;
+    }
+
+    _Buffer.setView(view);
+    _Buffer.clear();
+    _Buffer.draw(scene);
+    _Buffer.display();
+
+    if (_Pbo[0] == 0) {
+        _Sink->push(_Buffer.getTexture().copyToImage());
+        return;
+    }
+
+    //glReadPixels в PBO только ставит копирование в очередь видеокарты и сразу возвращается
+    auto size = _Buffer.getSize();
+    _Buffer.setActive(true);
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, _Pbo[_Next]);
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    _Next ^= 1;
+
+    //прошлый кадр к этому времени уже скопирован, и отображение буфера не ждёт видеокарту
+    if (_Pending)
+        _Collect(_Next);
+    _Pending = true;
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void alone::Recorder::_Collect(size_t buffer) {
+    auto size = _Buffer.getSize();
+    size_t row = (size_t)size.x * 4;
+
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, _Pbo[buffer]);
+    auto data = (const std::uint8_t*)gl.mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (data) {
+        //в видеопамяти строки идут снизу вверх
+        _Pixels.resize(row * size.y);
+        for (size_t y = 0; y != size.y; y++)
+            std::memcpy(_Pixels.data() + y * row, data + (size.y - 1 - y) * row, row);
+        gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        sf::Image frame;
+        frame.create(size.x, size.y, _Pixels.data());
+        _Sink->push(std::move(frame));
+    }
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
@@ -0,0 +1,146 @@
+#pragma once
+//std
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+//sfml
+#include <SFML/Graphics.hpp>
+
+namespace alone {
+    /**
+     *  получатель кадров: пишет их на диск в отдельном потоке
+        очередь ограничена, если диск не успевает, лишние кадры выбрасываются, а игра не ждёт
+     */
+    class FrameSink {
+    public:
+        enum Format {
+            /**
+             * все кадры подряд в один файл, по 4 байта RGBA на пиксель, без заголовков
+             */
+            Raw,
+
+            /**
+             * каждый кадр в свой файл path000001.png, path000002.png и так далее
+             */
+            Png
+        };
+
+        /**
+         * @param path файл для Raw или начало имени файлов для Png
+         * @param format
+         * @param capacity сколько кадров может ждать записи
+         */
+        FrameSink(std::string path, Format format, size_t capacity = 8);
+        FrameSink(const FrameSink&) = delete;
+        FrameSink& operator=(const FrameSink&) = delete;
+
+        /**
+         * дописывает всё, что осталось в очереди
+         */
+        ~FrameSink();
+
+        /**
+         * @return false, если очередь полна и кадр выброшен
+         */
+        bool push(sf::Image frame);
+
+        /**
+         *  очередь полна: следующий кадр будет выброшен
+            по ней можно не тратить время на чтение кадра из видеопамяти
+         */
+        bool full() const;
+
+        /**
+         * кадр выброшен, не дойдя до очереди, считается в dropped
+         */
+        void drop();
+
+        size_t written() const;
+        size_t dropped() const;
+
+    private:
+        void _Run();
+
+        std::string _Path;
+        Format _Format;
+        size_t _Capacity;
+        std::ofstream _Raw;
+
+        mutable std::mutex _Mutex;
+        std::condition_variable _Wake;
+        std::deque <sf::Image> _Queue;
+        bool _Stop = false;
+
+        std::atomic <size_t> _Written = 0, _Dropped = 0;
+        std::thread _Worker;
+    };
+
+    /**
+     *  запись игры в закадровый буфер постоянного размера, окно при этом не трогается
+        на главном потоке остаются только отрисовка и копирование готового кадра, кодирование и запись уходят в FrameSink
+        кадр читается из видеопамяти асинхронно через два pixel buffer object: пока видеокарта копирует кадр N в один,
+        из другого забирается кадр N - 1, поэтому запись отстаёт на кадр, зато главный поток не ждёт видеокарту
+        без PBO (драйвер старше OpenGL 2.1) кадр читается обычным copyToImage
+     */
+    class Recorder {
+    public:
+
+        /**
+         * @param width размер кадра
+         * @param height
+         * @param path
+         * @param format
+         * @param every записывать только каждый every-й кадр, чтобы копирование из видеопамяти было реже
+         * @return false, если не удалось создать буфер
+         */
+        bool start(unsigned width, unsigned height, const std::string& path, FrameSink::Format format, size_t every = 1);
+
+        /**
+         * останавливает запись, кадры из очереди дописываются
+         */
+        void stop();
+
+        bool recording() const;
+
+        /**
+         *  рисует сцену в буфер и отдаёт кадр на запись
+         * @param scene
+         * @param view область сцены, которая растягивается на весь кадр
+         */
+        void capture(const sf::Drawable& scene, const sf::View& view);
+
+    private:
+        /**
+         * отдаёт в FrameSink кадр, который лежит в _Pbo[buffer]
+         */
+        void _Collect(size_t buffer);
+
+        sf::RenderTexture _Buffer;
+        std::unique_ptr <FrameSink> _Sink;
+        size_t _Every = 1, _Frame = 0;
+
+        /**
+         * буферы для чтения кадров, нули - PBO нет
+         */
+        unsigned _Pbo[2] = { 0, 0 };
+
+        /**
+         * в какой буфер пойдёт следующий кадр, в другом может ждать прошлый
+         */
+        size_t _Next = 0;
+        bool _Pending = false;
+
+        /**
+         * строки кадра в порядке sf::Image, переиспользуется
+         */
+        std::vector <std::uint8_t> _Pixels;
+    };
+}
@@ -0,0 +1,165 @@
+#include "render.h"
+
+//std
+#include <algorithm>
+#include <tuple>
+
+void alone::RenderQueue::clear() {
+    _Commands.clear();
+    _Vertices.clear();
+    _Keys.clear();
+}
+
+void alone::RenderQueue::submit(std::int32_t layer, const sf::Vertex* vertices, size_t count, sf::PrimitiveType type,
+                                const sf::RenderStates& states) {
+    if (count == 0)
+        return;
+
+    size_t first = _Vertices.size();
+    for (size_t i = 0; i != count; i++) {
+        auto vertex = vertices[i];
+        vertex.position = states.transform.transformPoint(vertex.position);
+        _Vertices.push_back(vertex);
+    }
+    _Commands.push_back({ layer, _Key(states.texture, states.shader), states.texture, states.shader, states.blendMode, type,
+                          first, count, nullptr, sf::Transform(), _Commands.size() });
+}
+
+void alone::RenderQueue::submit(std::int32_t layer, const sf::Text& text, const sf::RenderStates& states) {
+    auto font = text.getFont();
+    auto string = text.getString();
+    if (!font || string.isEmpty())
+        return;
+
+    //раскладка как в sf::Text: строка начинается на высоте размера шрифта, вокруг буквы в текстуре отступ в пиксель
+    unsigned size = text.getCharacterSize();
+    float whitespace = font->getGlyph(L' ', size, false).advance;
+    float spacing = font->getLineSpacing(size);
+    const float padding = 1;
+
+    auto transform = states.transform * text.getTransform();
+    auto color = text.getFillColor();
+    size_t first = _Vertices.size();
+
+    float x = 0, y = (float)size;
+    std::uint32_t previous = 0;
+    for (size_t i = 0; i != string.getSize(); i++) {
+        std::uint32_t current = string[i];
+        x += font->getKerning(previous, current, size);
+        previous = current;
+
+        if (current == L' ' || current == L'\t' || current == L'\n') {
+            if (current == L' ')
+                x += whitespace;
+            else if (current == L'\t')
+                x += whitespace * 4;
+            else {
+                x = 0;
+                y += spacing;
+            }
+            continue;
+        }
+
+        auto& glyph = font->getGlyph(current, size, false);
+        float left = glyph.bounds.left - padding, top = glyph.bounds.top - padding;
+        float right = glyph.bounds.left + glyph.bounds.width + padding, bottom = glyph.bounds.top + glyph.bounds.height + padding;
+        float u1 = glyph.textureRect.left - padding, v1 = glyph.textureRect.top - padding;
+        float u2 = glyph.textureRect.left + glyph.textureRect.width + padding, v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+
+        auto corner = [&](float px, float py, float u, float v) {
+            _Vertices.emplace_back(transform.transformPoint(sf::Vector2f(x + px, y + py)), color, sf::Vector2f(u, v));
+        };
+        corner(left, top, u1, v1);
+        corner(right, top, u2, v1);
+        corner(right, bottom, u2, v2);
+        corner(left, bottom, u1, v2);
+
+        x += glyph.advance;
+    }
+
+    //текстура берётся после всех getGlyph: шрифт может её перестроить, когда добавляет буквы
+    if (_Vertices.size() != first) {
+        auto texture = &font->getTexture(size);
+        _Commands.push_back({ layer, _Key(texture, states.shader), texture, states.shader, states.blendMode, sf::Quads,
+                              first, _Vertices.size() - first, nullptr, sf::Transform(), _Commands.size() });
+    }
+}
+
+void alone::RenderQueue::submit(std::int32_t layer, const sf::Drawable& drawable, const sf::RenderStates& states) {
+    _Commands.push_back({ layer, _Key(states.texture, states.shader), states.texture, states.shader, states.blendMode, sf::Points,
+                          0, 0, &drawable, states.transform, _Commands.size() });
+}
+
+void alone::RenderQueue::flush(sf::RenderTarget& target, const sf::RenderStates& states) {
+    std::sort(_Commands.begin(), _Commands.end(), [](const Command& lhs, const Command& rhs) {
+        return std::make_tuple(lhs.layer, lhs.key, (int)lhs.type, lhs.order) <
+               std::make_tuple(rhs.layer, rhs.key, (int)rhs.type, rhs.order);
+    });
+
+    _Batches = 0;
+    for (size_t i = 0; i != _Commands.size();) {
+        auto& command = _Commands[i];
+        sf::RenderStates current = states;
+        current.texture = command.texture;
+        current.shader = command.shader;
+        current.blendMode = command.blend;
+
+        if (command.drawable) {
+            current.transform = states.transform * command.transform;
+            target.draw(*command.drawable, current);
+            _Batches++;
+            i++;
+            continue;
+        }
+
+        //вершины всех подходящих команд подряд в одном буфере
+        size_t next = i + 1;
+        while (next != _Commands.size() && _Mergeable(command, _Commands[next]))
+            next++;
+
+        const sf::Vertex* vertices = _Vertices.data() + command.first;
+        size_t count = command.count;
+        if (next != i + 1) {
+            _Batch.clear();
+            for (size_t j = i; j != next; j++)
+                _Batch.insert(_Batch.end(), _Vertices.begin() + _Commands[j].first, _Vertices.begin() + _Commands[j].first + _Commands[j].count);
+            vertices = _Batch.data();
+            count = _Batch.size();
+        }
+
+        target.draw(vertices, count, command.type, current);
+        _Batches++;
+        i = next;
+    }
+
+    clear();
+}
+
+size_t alone::RenderQueue::batches() const {
+    return _Batches;
+}
+
+sf::View alone::letterbox(sf::Vector2f resolution, sf::Vector2u size) {
+    sf::View view(sf::FloatRect(0, 0, resolution.x, resolution.y));
+    if (size.x == 0 || size.y == 0 || resolution.x <= 0 || resolution.y <= 0)
+        return view;
+
+    float scale = std::min(size.x / resolution.x, size.y / resolution.y);
+    float width = resolution.x * scale / size.x, height = resolution.y * scale / size.y;
+    view.setViewport(sf::FloatRect((1 - width) / 2, (1 - height) / 2, width, height));
+    return view;
+}
+
+size_t alone::RenderQueue::_Key(const sf::Texture* texture, const sf::Shader* shader) {
+    for (size_t i = 0; i != _Keys.size(); i++)
+        if (_Keys[i].first == texture && _Keys[i].second == shader)
+            return i;
+    _Keys.emplace_back(texture, shader);
+    return _Keys.size() - 1;
+}
+
+bool alone::RenderQueue::_Mergeable(const Command& batch, const Command& next) {
+    bool list = batch.type == sf::Points || batch.type == sf::Lines || batch.type == sf::Triangles || batch.type == sf::Quads;
+    return list && !next.drawable && next.texture == batch.texture && next.shader == batch.shader &&
+           next.type == batch.type && next.blend == batch.blend;
+}
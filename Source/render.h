@@ -0,0 +1,125 @@
+#pragma once
+//std
+#include <vector>
+#include <cstdint>
+
+//sfml
+#include <SFML/Graphics.hpp>
+
+namespace alone {
+    /**
+     *  очередь отрисовки кадра: состояния складывают сюда команды, а рисуется всё разом в flush
+        команды сортируются по слою, внутри слоя - по паре текстуры и шейдера и по типу примитива,
+        и соседние команды с одинаковыми ключами склеиваются в один вызов отрисовки
+        пары нумеруются заново каждый кадр в порядке первого добавления, поэтому порядок не зависит от адресов в памяти
+        и от кадра к кадру: в слое сначала рисуется всё с первой встреченной текстурой, потом со второй и так далее
+        вершины переводятся в координаты экрана ещё при добавлении, поэтому склеивать можно команды с разными преобразованиями
+        перекрывающиеся вещи с разными текстурами всё равно лучше класть в разные слои
+     */
+    class RenderQueue {
+    public:
+        /**
+         * слои рисуются по возрастанию
+         */
+        enum Layer : std::int32_t {
+            Background = 0,
+            Board = 10,
+            Interface = 20,
+            Overlay = 30
+        };
+
+        /**
+         * забывает все команды, память остаётся для следующего кадра
+         */
+        void clear();
+
+        /**
+         * вершины с текстурой, шейдером и режимом смешивания из states
+         */
+        void submit(std::int32_t layer, const sf::Vertex* vertices, size_t count, sf::PrimitiveType type,
+                    const sf::RenderStates& states = sf::RenderStates::Default);
+
+        /**
+         *  текст разбирается на четырёхугольники букв из текстуры шрифта через font.getGlyph,
+            поэтому все надписи одного размера рисуются одним вызовом
+            обводка и стили не поддерживаются, у надписей игры их нет
+         */
+        void submit(std::int32_t layer, const sf::Text& text, const sf::RenderStates& states = sf::RenderStates::Default);
+
+        /**
+         *  всё остальное рисуется как есть, отдельным вызовом в своём месте очереди
+            объект должен жить до flush
+         */
+        void submit(std::int32_t layer, const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default);
+
+        /**
+         * рисует все команды и очищает очередь
+         */
+        void flush(sf::RenderTarget& target, const sf::RenderStates& states = sf::RenderStates::Default);
+
+        /**
+         * сколько вызовов отрисовки ушло в последний flush
+         */
+        size_t batches() const;
+
+    private:
+        struct Command {
+            std::int32_t layer;
+            /**
+             * номер пары текстуры и шейдера в _Keys, по нему и сортируется
+             */
+            size_t key;
+            const sf::Texture* texture;
+            const sf::Shader* shader;
+            sf::BlendMode blend;
+            sf::PrimitiveType type;
+
+            /**
+             * вершины в _Vertices, у отдельного объекта - ноль
+             */
+            size_t first, count;
+
+            /**
+             * объект, который рисуется сам, иначе nullptr
+             */
+            const sf::Drawable* drawable;
+            sf::Transform transform;
+
+            /**
+             * номер добавления, чтобы сортировка была устойчивой
+             */
+            size_t order;
+        };
+
+        /**
+         *  можно ли дописать вершины next к команде, которая сейчас собирается
+            полосы и веера нельзя: их вершины продолжают друг друга
+         */
+        static bool _Mergeable(const Command& batch, const Command& next);
+
+        /**
+         * номер пары в порядке первого добавления за кадр
+         */
+        size_t _Key(const sf::Texture* texture, const sf::Shader* shader);
+
+        std::vector <Command> _Commands;
+        std::vector <sf::Vertex> _Vertices;
+
+        /**
+         * пары текстуры и шейдера этого кадра, их обычно несколько, так что хватает поиска подряд
+         */
+        std::vector <std::pair <const sf::Texture*, const sf::Shader*>> _Keys;
+
+        /**
+         * вершины склеенной команды, переиспользуется
+         */
+        std::vector <sf::Vertex> _Batch;
+        size_t _Batches = 0;
+    };
+
+    /**
+     *  вид, который показывает область 0..resolution целиком на цели размера size
+        масштаб одинаковый по обеим осям, лишнее место по краям остаётся полосами
+     */
+    sf::View letterbox(sf::Vector2f resolution, sf::Vector2u size);
+}
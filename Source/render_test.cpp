@@ -0,0 +1,233 @@
+//проверка отрисовки GameState по эталонным картинкам и замер времени кадра
+//игра гоняется без окна: зерно фиксировано, нажатия подставляются в alone::input
+//эталоны лежат в golden/, без эталона тест падает; с переменной SAPER_UPDATE_GOLDEN кадры записываются как новые эталоны
+
+#include <doctest.h>
+#include "src.h"
+
+//std
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+
+namespace {
+    /**
+     * одно нажатие сценария: клетка и кнопка
+     */
+    struct Click {
+        unsigned x, y;
+        bool right = false;
+    };
+
+    //допустимая разница канала и доля пикселей, которым можно её превысить
+    const int Tolerance = 8;
+    const double Outliers = 0.001;
+
+    //среднее время update + draw, больше которого кадр считается регрессией
+    //на общих машинах время скачет, поэтому проверка только по заказу, иначе время просто печатается
+    double frameBudget() {
+        auto value = std::getenv("SAPER_FRAME_BUDGET_US");
+        return value ? std::atof(value) : 0;
+    }
+
+    void loadAssets() {
+        static bool loaded = false;
+        if (loaded)
+            return;
+        loaded = true;
+
+        static alone::Bundle assets;
+        REQUIRE(assets.open(alone::executableDirectory() + "assets.pak"));
+
+        textures.load(assets, "material/textures/include.txt");
+        tiles_handle = textures.find("minesweeper.png");
+        while (!textures.poll())
+            std::this_thread::yield();
+
+        auto data = assets.find("material/font.ttf");
+        REQUIRE(font.loadFromMemory(data.data(), data.size()));
+
+        difficulties[0] = {"Easy", 10, 8};
+        difficulties[1] = {"Medium", 20, 10};
+        difficulties[2] = {"Hard", 70, 20};
+    }
+
+    /**
+     * @return сколько пикселей отличаются больше, чем на Tolerance
+     */
+    size_t compare(const sf::Image& lhs, const sf::Image& rhs) {
+        auto size = lhs.getSize();
+        auto a = lhs.getPixelsPtr(), b = rhs.getPixelsPtr();
+
+        size_t wrong = 0;
+        for (size_t i = 0; i != (size_t)size.x * size.y; i++)
+            for (size_t c = 0; c != 4; c++)
+                if (std::abs(a[i * 4 + c] - b[i * 4 + c]) > Tolerance) {
+                    wrong++;
+                    break;
+                }
+        return wrong;
+    }
+
+    void checkGolden(const sf::Image& frame, const std::string& name) {
+        std::filesystem::path path = std::filesystem::path(SAPER_GOLDEN_DIR) / (name + ".png");
+
+        if (std::getenv("SAPER_UPDATE_GOLDEN")) {
+            std::filesystem::create_directories(path.parent_path());
+            REQUIRE(frame.saveToFile(path.string()));
+            MESSAGE("recorded golden image " << path.string());
+            return;
+        }
+
+        sf::Image golden;
+        if (!std::filesystem::exists(path) || !golden.loadFromFile(path.string())) {
+            frame.saveToFile((path.parent_path() / (name + ".actual.png")).string());
+            FAIL_CHECK(name << ": no golden image " << path.string() << ", record it with SAPER_UPDATE_GOLDEN=1");
+            return;
+        }
+
+        REQUIRE(golden.getSize() == frame.getSize());
+        size_t wrong = compare(frame, golden);
+        if (wrong > Outliers * frame.getSize().x * frame.getSize().y) {
+            frame.saveToFile((path.parent_path() / (name + ".actual.png")).string());
+            FAIL_CHECK(name << ": " << wrong << " pixels differ");
+        }
+    }
+
+    /**
+     * прогоняет сценарий на одном уровне и сверяет кадр после каждого нажатия
+     */
+    void play(size_t level, std::uint64_t seed, const std::vector <Click>& script, const std::string& name) {
+        GameState game(level, seed);
+        game.onCreate();
+        //кадр после нажатия должен показывать всю заливку, а не сколько успелось
+        game._FloodBudget = {};
+
+        size_t size = difficulties[level].size;
+        sf::RenderTexture buffer;
+        REQUIRE(buffer.create(size * 32, size * 32 + game._InterfaceOffset));
+
+        std::vector <double> times;
+        for (size_t i = 0; i != script.size(); i++) {
+            auto& click = script[i];
+
+            //нажатие засчитывается, когда кнопка отпущена
+            alone::input::mouse = sf::Vector2i(click.x * 32 + 16, game._InterfaceOffset + click.y * 32 + 16);
+            alone::input::preLmb = !click.right;
+            alone::input::preRmb = click.right;
+            alone::input::nowLmb = alone::input::nowRmb = false;
+
+            auto start = std::chrono::steady_clock::now();
+            game.update();
+            //таймер зависит от того, как быстро идёт тест, в эталон он попадает всегда нулевым
+            game._TimerLabel.setString("0:0");
+            buffer.clear();
+            game.draw(buffer, sf::RenderStates::Default);
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration <double, std::micro>(end - start).count());
+
+            buffer.display();
+            checkGolden(buffer.getTexture().copyToImage(), name + "_" + std::to_string(i));
+
+            if (game._GameStatus != 'a')
+                break;
+        }
+
+        game.onDelete();
+        MESSAGE(name << ": slowest frame " << *std::max_element(times.begin(), times.end()) << " us");
+    }
+}
+
+TEST_CASE("Rendering easy game against golden images.")
+{
+    loadAssets();
+    play(0, 1, { {4, 4}, {0, 0, true}, {7, 7}, {0, 7}, {7, 0} }, "easy");
+}
+
+TEST_CASE("Rendering hard game against golden images.")
+{
+    loadAssets();
+    play(2, 2, { {10, 10}, {0, 0, true}, {19, 19}, {0, 19} }, "hard");
+}
+
+TEST_CASE("Shader tiles match vertex tiles.")
+{
+    loadAssets();
+    if (!sf::Shader::isAvailable()) {
+        MESSAGE("shaders are not available, only the vertex path is used");
+        return;
+    }
+
+    Map map;
+    map.resize(20);
+    std::mt19937_64 rng(4);
+    map.generate(70, 10, 10, rng);
+    map.reveal(10, 10);
+    map.flag(0, 0);
+
+    auto& region = textures[textures.find("minesweeper.png")];
+    sf::Vector2f origin(region.rect.left, region.rect.top), offset(0, 100);
+    alone::TileRenderer shaded, plain;
+    REQUIRE(shaded.create(20, region.texture, origin, offset));
+    REQUIRE(plain.create(20, region.texture, origin, offset, false));
+    REQUIRE(shaded.shaded());
+
+    //после полной загрузки и после двух ходов без update между ними: в текстуру уходят изменения обоих
+    for (size_t step = 0; step != 2; step++) {
+        shaded.update(map);
+        plain.update(map);
+
+        sf::RenderTexture lhs, rhs;
+        REQUIRE(lhs.create(640, 740));
+        REQUIRE(rhs.create(640, 740));
+        lhs.clear();
+        lhs.draw(shaded);
+        lhs.display();
+        rhs.clear();
+        rhs.draw(plain);
+        rhs.display();
+        CHECK(compare(lhs.getTexture().copyToImage(), rhs.getTexture().copyToImage()) == 0);
+
+        map.reveal(19, 19);
+        map.reveal(0, 19);
+    }
+}
+
+TEST_CASE("Frame time of the hard level.")
+{
+    loadAssets();
+
+    //клики мимо поля: каждый кадр только пересчитывает вершины и рисует
+    GameState game(2, 3);
+    game.onCreate();
+    sf::RenderTexture buffer;
+    REQUIRE(buffer.create(640, 740));
+
+    alone::input::mouse = sf::Vector2i(-1, -1);
+    alone::input::preLmb = alone::input::nowLmb = false;
+    alone::input::preRmb = alone::input::nowRmb = false;
+
+    std::vector <double> times;
+    for (size_t i = 0; i != 200; i++) {
+        auto start = std::chrono::steady_clock::now();
+        game.update();
+        buffer.clear();
+        game.draw(buffer, sf::RenderStates::Default);
+        buffer.display();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration <double, std::micro>(end - start).count());
+    }
+    game.onDelete();
+
+    double mean = 0;
+    for (auto it : times)
+        mean += it;
+    mean /= times.size();
+    std::sort(times.begin(), times.end());
+
+    MESSAGE("frame: mean " << mean << " us, median " << times[times.size() / 2] << " us, max " << times.back() << " us");
+    if (frameBudget() > 0)
+        CHECK(mean < frameBudget());
+}
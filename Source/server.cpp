@@ -0,0 +1,524 @@
+#include "server.h"
+
+//std
+#include <random>
+#include <iostream>
+
+//linux
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+    //больше этого сообщения от клиента не бывают, всё длиннее - мусор
+    const size_t MaxMessage = 64;
+
+    const int MaxEvents = 64;
+
+    bool address(const std::string& path, sockaddr_un& out) {
+        std::memset(&out, 0, sizeof(out));
+        out.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(out.sun_path))
+            return false;
+        std::memcpy(out.sun_path, path.data(), path.size());
+        return true;
+    }
+}
+
+void alone::protocol::write(std::string& out, std::uint64_t value, size_t bytes) {
+    for (size_t i = 0; i != bytes; i++)
+        out.push_back((char)(value >> (8 * i)));
+}
+
+std::uint64_t alone::protocol::Reader::read(size_t bytes) {
+    if (position + bytes > data.size()) {
+        ok = false;
+        return 0;
+    }
+
+    std::uint64_t value = 0;
+    for (size_t i = 0; i != bytes; i++)
+        value |= (std::uint64_t)(std::uint8_t)data[position + i] << (8 * i);
+    position += bytes;
+    return value;
+}
+
+std::string alone::protocol::frame(const std::string& payload) {
+    std::string out;
+    write(out, payload.size(), 4);
+    return out + payload;
+}
+
+std::string alone::protocol::join(std::uint32_t game, std::uint64_t seed, std::uint16_t size, std::uint32_t bombs) {
+    std::string out(1, (char)Join);
+    write(out, game, 4);
+    write(out, seed, 8);
+    write(out, size, 2);
+    write(out, bombs, 4);
+    return out;
+}
+
+std::string alone::protocol::reveal(std::uint16_t x, std::uint16_t y) {
+    std::string out(1, (char)Reveal);
+    write(out, x, 2);
+    write(out, y, 2);
+    return out;
+}
+
+std::string alone::protocol::flag(std::uint16_t x, std::uint16_t y) {
+    std::string out(1, (char)Flag);
+    write(out, x, 2);
+    write(out, y, 2);
+    return out;
+}
+
+alone::Server::Server(size_t backlog) {
+    _Backlog = backlog;
+}
+
+alone::Server::~Server() {
+    for (auto& [socket, connection] : _Connections)
+        ::close(socket);
+    if (_Listener != -1) {
+        ::close(_Listener);
+        ::unlink(_Path.c_str());
+    }
+    if (_Poll != -1)
+        ::close(_Poll);
+}
+
+bool alone::Server::listen(const std::string& path) {
+    sockaddr_un addr;
+    if (!address(path, addr))
+        return false;
+
+    _Listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_Listener == -1)
+        return false;
+
+    ::unlink(path.c_str());
+    if (::bind(_Listener, (sockaddr*)&addr, sizeof(addr)) == -1 || ::listen(_Listener, SOMAXCONN) == -1) {
+        std::cerr << "server: can't listen on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(_Listener);
+        _Listener = -1;
+        return false;
+    }
+    _Path = path;
+
+    _Poll = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = _Listener;
+    return _Poll != -1 && ::epoll_ctl(_Poll, EPOLL_CTL_ADD, _Listener, &event) == 0;
+}
+
+void alone::Server::poll(int timeout) {
+    epoll_event events[MaxEvents];
+    int count = ::epoll_wait(_Poll, events, MaxEvents, timeout);
+
+    for (int i = 0; i < count; i++) {
+        int socket = events[i].data.fd;
+        if (socket == _Listener) {
+            _Accept();
+            continue;
+        }
+
+        //соединение могло закрыться раньше в этом же проходе
+        if (!_Connections.contains(socket))
+            continue;
+        if (events[i].events & EPOLLERR) {
+            _Close(socket);
+            continue;
+        }
+        if (events[i].events & EPOLLOUT)
+            _Flush(socket);
+
+        //после ухода клиента EPOLLHUP приходит вместе с EPOLLIN, пока не прочитаны его последние сообщения,
+        //тогда _Read сам закроет соединение, дойдя до конца потока
+        if (events[i].events & EPOLLIN)
+            _Read(socket);
+        else if (events[i].events & EPOLLHUP)
+            _Close(socket);
+    }
+
+    //все изменения партии за проход уходят каждому её игроку одной посылкой
+    for (auto id : _Touched) {
+        auto it = _Games.find(id);
+        if (it == _Games.end())
+            continue;
+
+        auto& game = it->second;
+        auto message = protocol::frame(game.pending);
+        game.pending.clear();
+        for (auto& player : game.players) {
+            if (player.connection == -1)
+                continue;
+            auto& connection = _Connections[player.connection];
+            connection.output += message;
+            _Flush(player.connection);
+            if (connection.output.size() > _Backlog)
+                _Slow.push_back(player.connection);
+        }
+    }
+    _Touched.clear();
+
+    //закрытие может удалить партию, поэтому не во время обхода её игроков
+    for (auto socket : _Slow)
+        _Close(socket);
+    _Slow.clear();
+}
+
+size_t alone::Server::games() const {
+    return _Games.size();
+}
+
+size_t alone::Server::connections() const {
+    return _Connections.size();
+}
+
+void alone::Server::_Accept() {
+    while (true) {
+        int socket = ::accept4(_Listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket == -1)
+            return;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        if (::epoll_ctl(_Poll, EPOLL_CTL_ADD, socket, &event) == -1) {
+            ::close(socket);
+            continue;
+        }
+        _Connections[socket];
+    }
+}
+
+void alone::Server::_Read(int socket) {
+    auto& connection = _Connections[socket];
+
+    //клиент мог дописать сообщения и сразу уйти: они приходят вместе с концом потока и обрабатываются до закрытия
+    char buffer[4096];
+    bool ended = false;
+    while (true) {
+        ssize_t got = ::recv(socket, buffer, sizeof(buffer), 0);
+        if (got > 0) {
+            connection.input.append(buffer, got);
+            continue;
+        }
+        if (got == 0) {
+            ended = true;
+            break;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+
+        //ошибка сокета
+        _Close(socket);
+        return;
+    }
+
+    size_t position = 0;
+    while (connection.input.size() - position >= 4) {
+        protocol::Reader reader{ connection.input, position };
+        size_t length = reader.read(4);
+        if (length == 0 || length > MaxMessage) {
+            _Close(socket);
+            return;
+        }
+        if (connection.input.size() - position - 4 < length)
+            break;
+
+        _Handle(socket, connection.input.substr(position + 4, length));
+        position += 4 + length;
+
+        //обработка могла закрыть соединение
+        if (!_Connections.contains(socket))
+            return;
+    }
+    connection.input.erase(0, position);
+
+    if (ended)
+        _Close(socket);
+}
+
+void alone::Server::_Handle(int socket, const std::string& payload) {
+    protocol::Reader reader{ payload };
+    auto type = (protocol::Message)reader.read(1);
+
+    switch (type) {
+        case protocol::Join:
+            _Join(socket, reader);
+            break;
+        case protocol::Reveal:
+        case protocol::Flag:
+            _Move(socket, type, reader);
+            break;
+        default:
+            _Close(socket);
+            break;
+    }
+}
+
+void alone::Server::_Join(int socket, protocol::Reader& reader) {
+    auto& connection = _Connections[socket];
+    std::uint32_t id = reader.read(4);
+    std::uint64_t seed = reader.read(8);
+    size_t size = reader.read(2);
+    size_t bombs = reader.read(4);
+
+    std::string rejected(1, (char)protocol::Rejected);
+    rejected.push_back((char)protocol::Join);
+    if (!reader.ok || connection.joined) {
+        _Send(socket, rejected);
+        return;
+    }
+
+    auto it = _Games.find(id);
+    if (it == _Games.end()) {
+        if (size == 0 || size > MaxSize || bombs >= size * size) {
+            _Send(socket, rejected);
+            return;
+        }
+
+        //первое нажатие в гонке у всех одно и то же - центр карты, иначе карты бы разошлись
+        Game game;
+        game.size = size;
+        game.bombs = bombs;
+        game.x = size / 2;
+        game.y = size / 2;
+
+        //области нужны всегда, поэтому числа считаются сразу и на самой большой карте
+        std::mt19937_64 rng(seed);
+        auto board = std::make_shared <Map>();
+        board->numbers(Map::Numbers::Eager);
+        board->resize(size);
+        board->generate(bombs, game.x, game.y, rng);
+        game.board = std::move(board);
+        it = _Games.emplace(id, std::move(game)).first;
+    }
+
+    auto& game = it->second;
+    connection.joined = true;
+    connection.game = id;
+    connection.player = game.players.size();
+
+    //расклад у всех общий, игроку достаётся только байт состояния на клетку
+    game.players.emplace_back(game.board, socket);
+
+    std::string joined(1, (char)protocol::Joined);
+    protocol::write(joined, connection.player, 4);
+    protocol::write(joined, game.size, 2);
+    protocol::write(joined, game.bombs, 4);
+    protocol::write(joined, game.x, 2);
+    protocol::write(joined, game.y, 2);
+    _Send(socket, joined);
+}
+
+void alone::Server::_Move(int socket, protocol::Message type, protocol::Reader& reader) {
+    auto& connection = _Connections[socket];
+    size_t x = reader.read(2);
+    size_t y = reader.read(2);
+
+    std::string rejected(1, (char)protocol::Rejected);
+    rejected.push_back((char)type);
+    if (!reader.ok || !connection.joined) {
+        _Send(socket, rejected);
+        return;
+    }
+
+    auto& game = _Games[connection.game];
+    auto& player = game.players[connection.player];
+    if (player.status != 'a' || x >= game.size || y >= game.size) {
+        _Send(socket, rejected);
+        return;
+    }
+
+    auto& map = player.map;
+    if (type == protocol::Reveal) {
+        map.reveal(x, y);
+        if (map.lost())
+            player.status = 'l';
+        else if (map.won())
+            player.status = 'w';
+    } else
+        map.flag(x, y);
+
+    //ход, который ничего не поменял, никому не интересен
+    if (map._Dirty.empty())
+        return;
+
+    if (game.pending.empty()) {
+        game.pending.push_back((char)protocol::Diff);
+        _Touched.push_back(connection.game);
+    }
+    protocol::write(game.pending, connection.player, 4);
+    game.pending.push_back(player.status);
+
+    _Delta.clear();
+    player.delta.encode(map, _Delta);
+    protocol::write(game.pending, _Delta.size(), 4);
+    game.pending += _Delta;
+}
+
+void alone::Server::_Send(int socket, const std::string& payload) {
+    auto& connection = _Connections[socket];
+    connection.output += protocol::frame(payload);
+    _Flush(socket);
+    if (connection.output.size() > _Backlog)
+        _Close(socket);
+}
+
+void alone::Server::_Flush(int socket) {
+    auto& connection = _Connections[socket];
+
+    size_t sent = 0;
+    while (sent != connection.output.size()) {
+        ssize_t done = ::send(socket, connection.output.data() + sent, connection.output.size() - sent, MSG_NOSIGNAL);
+        if (done > 0) {
+            sent += done;
+            continue;
+        }
+
+        //ошибку тут не обрабатываем, соединение закроется по следующему событию от epoll
+        if (done == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+            sent = connection.output.size();
+        break;
+    }
+    connection.output.erase(0, sent);
+
+    //ждать возможности записи нужно только пока есть что дописывать
+    bool writing = !connection.output.empty();
+    if (writing != connection.writing) {
+        connection.writing = writing;
+        epoll_event event{};
+        event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = socket;
+        ::epoll_ctl(_Poll, EPOLL_CTL_MOD, socket, &event);
+    }
+}
+
+void alone::Server::_Close(int socket) {
+    auto it = _Connections.find(socket);
+    if (it == _Connections.end())
+        return;
+
+    ::epoll_ctl(_Poll, EPOLL_CTL_DEL, socket, nullptr);
+    ::close(socket);
+
+    auto connection = std::move(it->second);
+    _Connections.erase(it);
+    if (!connection.joined)
+        return;
+
+    //партия живёт, пока в ней остаётся хоть один игрок
+    auto& game = _Games[connection.game];
+    game.players[connection.player].connection = -1;
+    for (auto& player : game.players)
+        if (player.connection != -1)
+            return;
+    _Games.erase(connection.game);
+}
+
+alone::RaceBoard::RaceBoard(std::shared_ptr <const Map> layout)
+    : Engine(topology::Square(layout->_Content.size(), layout->_Content.size())), _Layout(std::move(layout)) {
+    _States.assign(_Shape.cells(), 'n');
+    _Bombs = _Layout->_Bombs;
+}
+
+bool alone::RaceBoard::reveal(size_t x, size_t y) {
+    return _Reveal(x + y * _Shape.width());
+}
+
+bool alone::RaceBoard::flag(size_t x, size_t y) {
+    return _Flag(x + y * _Shape.width());
+}
+
+std::uint8_t alone::RaceBoard::visible(size_t index) const {
+    if (_States[index] == 'r')
+        return (std::uint8_t)_Layout->_Content.data()[index].second;
+    if (_States[index] == 'f')
+        return (std::uint8_t)Type::Flag;
+    return (std::uint8_t)Type::Unknown;
+}
+
+char& alone::RaceBoard::_State(size_t index) {
+    return _States[index];
+}
+
+std::uint8_t alone::RaceBoard::_Around(size_t index) const {
+    auto type = _Layout->_Content.data()[index].second;
+    if (type == Type::Bomb)
+        return Mine;
+    return type == Type::None ? 0 : (std::uint8_t)type + 1;
+}
+
+bool alone::RaceBoard::_Mine(size_t index) const {
+    return _Layout->_Content.data()[index].second == Type::Bomb;
+}
+
+bool alone::RaceBoard::_OpenArea(size_t index) {
+    //флаг внутри области разрывает заливку; счётчиков флагов по областям у игрока нет,
+    //поэтому с любым флагом на поле открываем обычной заливкой, итог тот же
+    auto r = _Layout->regionOf(index);
+    if (r == Map::NoRegion || remaining() != (std::ptrdiff_t)_Bombs)
+        return false;
+
+    for (auto i : _Layout->region(r))
+        if (_States[i] == 'n')
+            _Open(i);
+    return true;
+}
+
+alone::Client::~Client() {
+    if (_Socket != -1)
+        ::close(_Socket);
+}
+
+bool alone::Client::connect(const std::string& path) {
+    sockaddr_un addr;
+    if (!address(path, addr))
+        return false;
+
+    _Socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    return _Socket != -1 && ::connect(_Socket, (sockaddr*)&addr, sizeof(addr)) == 0;
+}
+
+bool alone::Client::send(const std::string& payload) {
+    auto message = protocol::frame(payload);
+    size_t sent = 0;
+    while (sent != message.size()) {
+        ssize_t done = ::send(_Socket, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (done <= 0)
+            return false;
+        sent += done;
+    }
+    return true;
+}
+
+std::optional <std::string> alone::Client::receive(int timeout) {
+    while (true) {
+        if (_Input.size() >= 4) {
+            protocol::Reader reader{ _Input };
+            size_t length = reader.read(4);
+            if (_Input.size() - 4 >= length) {
+                auto payload = _Input.substr(4, length);
+                _Input.erase(0, 4 + length);
+                return payload;
+            }
+        }
+
+        pollfd descriptor{ _Socket, POLLIN, 0 };
+        if (::poll(&descriptor, 1, timeout) <= 0)
+            return std::nullopt;
+
+        char buffer[4096];
+        ssize_t got = ::recv(_Socket, buffer, sizeof(buffer), 0);
+        if (got <= 0)
+            return std::nullopt;
+        _Input.append(buffer, got);
+    }
+}
@@ -0,0 +1,230 @@
+#pragma once
+//сервер работает только под linux, ему нужен epoll
+//std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <memory>
+#include <cstdint>
+
+#include "map.h"
+#include "delta.h"
+
+namespace alone::protocol {
+    /**
+     *  каждое сообщение - это u32 длина и сама посылка, первый байт посылки - её тип
+        все числа записываются младшим байтом вперёд
+     */
+    enum Message : std::uint8_t {
+        /**
+         *  клиент -> сервер: u32 игра, u64 зерно, u16 размер, u32 бомбы
+            первый вошедший создаёт игру, у остальных параметры игнорируются
+         */
+        Join = 1,
+
+        /**
+         * клиент -> сервер: u16 x, u16 y
+         */
+        Reveal,
+        Flag,
+
+        /**
+         * сервер -> клиент: u32 номер игрока, u16 размер, u32 бомбы, u16 x, u16 y стартовой клетки
+         */
+        Joined = 16,
+
+        /**
+         *  сервер -> клиент: за один проход сервера изменения всех игроков партии собираются в одну посылку,
+            после типа до конца посылки идут записи по одной на ход:
+                u32 игрок, u8 статус ('a', 'w', 'l'), u32 длина, сообщение DeltaEncoder этого игрока
+         */
+        Diff,
+
+        /**
+         * сервер -> клиент: u8 тип отвергнутого сообщения
+         */
+        Rejected
+    };
+
+    std::string join(std::uint32_t game, std::uint64_t seed, std::uint16_t size, std::uint32_t bombs);
+    std::string reveal(std::uint16_t x, std::uint16_t y);
+    std::string flag(std::uint16_t x, std::uint16_t y);
+
+    /**
+     * оборачивает посылку в сообщение с длиной
+     */
+    std::string frame(const std::string& payload);
+
+    /**
+     *  чтение чисел из посылки по порядку
+        если посылка кончилась, ok становится false, а числа читаются нулями
+     */
+    struct Reader {
+        const std::string& data;
+        size_t position = 0;
+        bool ok = true;
+
+        std::uint64_t read(size_t bytes);
+    };
+
+    void write(std::string& out, std::uint64_t value, size_t bytes);
+}
+
+namespace alone {
+    /**
+     *  поле одного игрока гонки поверх общего расклада партии
+        бомбы, числа и пустые области лежат в одной Map на всех игроков и только читаются,
+        у игрока свой только байт состояния на клетку
+     */
+    class RaceBoard : public Engine <RaceBoard, topology::Square> {
+        friend Engine;
+
+    public:
+        explicit RaceBoard(std::shared_ptr <const Map> layout);
+
+        bool reveal(size_t x, size_t y);
+        bool flag(size_t x, size_t y);
+
+        /**
+         * то же, что и Map::visible
+         */
+        std::uint8_t visible(size_t index) const;
+
+    private:
+        char& _State(size_t index);
+        std::uint8_t _Around(size_t index) const;
+        bool _Mine(size_t index) const;
+
+        /**
+         * готовая область расклада открывается целиком, только пока у игрока нет ни одного флага
+         */
+        bool _OpenArea(size_t index);
+        void _Flagged(size_t, int) {}
+
+        std::shared_ptr <const Map> _Layout;
+        std::vector <char> _States;
+    };
+
+    /**
+     *  сервер гонки: все игроки одной партии играют одну и ту же карту, каждый на своём RaceBoard
+        каждое нажатие проверяется по карте сервера, клиенту доверять нельзя
+        одно событийное кольцо epoll на весь процесс, сокеты неблокирующие
+     */
+    class Server {
+    public:
+        /**
+         *  @param backlog сколько байт может ждать отправки одному клиенту;
+            кто читает медленнее, чем идут изменения, отключается, а не копит память сервера
+         */
+        explicit Server(size_t backlog = 1 << 20);
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+        ~Server();
+
+        /**
+         * @param path путь unix-сокета, старый файл сокета удаляется
+         * @return
+         */
+        bool listen(const std::string& path);
+
+        /**
+         *  один проход: ждёт события не дольше timeout миллисекунд, обрабатывает их
+            и рассылает накопленные изменения
+         */
+        void poll(int timeout);
+
+        size_t games() const;
+        size_t connections() const;
+
+    private:
+        struct Player {
+            Player(std::shared_ptr <const Map> layout, int socket) : map(std::move(layout)), connection(socket) {}
+
+            RaceBoard map;
+            char status = 'a';
+            int connection = -1;
+            DeltaEncoder delta;
+        };
+
+        struct Game {
+            /**
+             * расклад партии, общий для всех её игроков
+             */
+            std::shared_ptr <const Map> board;
+            size_t size = 0, bombs = 0;
+            size_t x = 0, y = 0;
+            std::vector <Player> players;
+
+            /**
+             * изменения, накопленные за текущий проход
+             */
+            std::string pending;
+        };
+
+        struct Connection {
+            std::string input, output;
+            std::uint32_t game = 0;
+            std::uint32_t player = 0;
+            bool joined = false;
+            //в epoll ждём и возможности записи
+            bool writing = false;
+        };
+
+        void _Accept();
+        void _Read(int socket);
+        void _Handle(int socket, const std::string& payload);
+        void _Join(int socket, protocol::Reader& reader);
+        void _Move(int socket, protocol::Message type, protocol::Reader& reader);
+        void _Send(int socket, const std::string& payload);
+        void _Flush(int socket);
+        void _Close(int socket);
+
+        size_t _Backlog;
+        int _Listener = -1;
+        int _Poll = -1;
+        std::string _Path;
+
+        std::unordered_map <int, Connection> _Connections;
+        std::unordered_map <std::uint32_t, Game> _Games;
+
+        /**
+         * партии, у которых за текущий проход появились изменения
+         */
+        std::vector <std::uint32_t> _Touched;
+
+        /**
+         * буфер под сообщение об одном ходе
+         */
+        std::string _Delta;
+
+        /**
+         * клиенты, переполнившие очередь отправки за текущий проход
+         */
+        std::vector <int> _Slow;
+    };
+
+    /**
+     * простой блокирующий клиент для тестов и утилит
+     */
+    class Client {
+    public:
+        Client() = default;
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+        ~Client();
+
+        bool connect(const std::string& path);
+        bool send(const std::string& payload);
+
+        /**
+         * ждёт одно сообщение не дольше timeout миллисекунд
+         * @return посылка без длины
+         */
+        std::optional <std::string> receive(int timeout);
+
+    private:
+        int _Socket = -1;
+        std::string _Input;
+    };
+}
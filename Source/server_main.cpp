@@ -0,0 +1,32 @@
+//сервер гонки на одном unix-сокете, все партии в одном процессе
+//SaperServer <путь сокета>
+
+#include "server.h"
+
+//std
+#include <iostream>
+#include <csignal>
+
+namespace {
+    volatile std::sig_atomic_t running = 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <socket>\n";
+        return 1;
+    }
+
+    alone::Server server;
+    if (!server.listen(argv[1]))
+        return 1;
+
+    //по сигналу выходим из цикла, чтобы деструктор убрал файл сокета
+    std::signal(SIGINT, [](int) { running = 0; });
+    std::signal(SIGTERM, [](int) { running = 0; });
+
+    while (running)
+        server.poll(100);
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "sparse.h"
+
+//std
+#include <algorithm>
+
+alone::SparseMap::SparseMap(std::pmr::memory_resource* resource) :
+    _Dirty(resource), _Mines(resource), _Revealed(resource), _Flags(resource), _Stack(resource) {
+}
+
+void alone::SparseMap::resize(std::uint64_t size) {
+    _Size = size;
+    _Mines.clear();
+    _Revealed.clear();
+    _Flags.clear();
+    _Dirty.clear();
+    _RevealedSafe = _CorrectFlags = _Exploded = 0;
+}
+
+void alone::SparseMap::generate(std::uint64_t bombs, std::uint64_t x, std::uint64_t y, std::mt19937_64& rng) {
+    resize(_Size);
+
+    //выбор bombs номеров из всех клеток, кроме первой: номера от неё и дальше сдвигаются на один
+    std::uint64_t first = x + y * _Size, cells = _Size * _Size - 1;
+    bombs = std::min(bombs, cells);
+
+    //повтор выпадает с вероятностью около bombs / cells, так что каждый круг уменьшает недостачу во много раз
+    _Mines.reserve(bombs);
+    while (_Mines.size() != bombs) {
+        while (_Mines.size() != bombs)
+            _Mines.push_back(rng() % cells);
+        std::sort(_Mines.begin(), _Mines.end());
+        _Mines.erase(std::unique(_Mines.begin(), _Mines.end()), _Mines.end());
+    }
+
+    //сдвиг не меняет порядок, поэтому массив остаётся отсортированным
+    for (auto& it : _Mines)
+        if (it >= first)
+            it++;
+}
+
+bool alone::SparseMap::reveal(std::uint64_t x, std::uint64_t y) {
+    _Dirty.clear();
+    if (!_Closed(x, y))
+        return false;
+
+    _Stack.assign(1, { x, y });
+    _Flood();
+    return _IsMine(x + y * _Size);
+}
+
+bool alone::SparseMap::flag(std::uint64_t x, std::uint64_t y) {
+    _Dirty.clear();
+    std::uint64_t index = x + y * _Size;
+    if (_IsRevealed(index))
+        return false;
+
+    bool placed = _Flags.insert(index).second;
+    if (!placed)
+        _Flags.erase(index);
+    if (_IsMine(index))
+        _CorrectFlags += placed ? 1 : -1;
+    _Dirty.emplace_back(index, index + 1);
+    return placed;
+}
+
+bool alone::SparseMap::chord(std::uint64_t x, std::uint64_t y) {
+    _Dirty.clear();
+    std::uint64_t index = x + y * _Size;
+    if (!_IsRevealed(index) || _IsMine(index))
+        return false;
+
+    size_t number = _Around(x, y), flags = 0;
+    if (number == 0)
+        return false;
+
+    auto forAround = [&](auto&& visit) {
+        for (std::uint64_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < _Size; j++)
+            for (std::uint64_t i = x == 0 ? 0 : x - 1; i <= x + 1 && i < _Size; i++)
+                if (i != x || j != y)
+                    visit(i, j);
+    };
+    forAround([&](std::uint64_t i, std::uint64_t j) { flags += _Flags.count(i + j * _Size); });
+    if (flags != number)
+        return false;
+
+    bool bomb = false;
+    _Stack.clear();
+    forAround([&](std::uint64_t i, std::uint64_t j) {
+        if (_Closed(i, j)) {
+            _Stack.emplace_back(i, j);
+            bomb |= _IsMine(i + j * _Size);
+        }
+    });
+    _Flood();
+    return bomb;
+}
+
+std::uint8_t alone::SparseMap::visible(std::uint64_t x, std::uint64_t y) const {
+    std::uint64_t index = x + y * _Size;
+    if (_IsRevealed(index))
+        return (std::uint8_t)content(x, y);
+    if (_Flags.count(index))
+        return (std::uint8_t)Type::Flag;
+    return (std::uint8_t)Type::Unknown;
+}
+
+Type alone::SparseMap::content(std::uint64_t x, std::uint64_t y) const {
+    if (_IsMine(x + y * _Size))
+        return Type::Bomb;
+    size_t value = _Around(x, y);
+    return value == 0 ? Type::None : (Type)(value - 1);
+}
+
+std::uint64_t alone::SparseMap::size() const {
+    return _Size;
+}
+
+std::uint64_t alone::SparseMap::revealed() const {
+    return _RevealedSafe;
+}
+
+std::uint64_t alone::SparseMap::correctFlags() const {
+    return _CorrectFlags;
+}
+
+std::int64_t alone::SparseMap::remaining() const {
+    return (std::int64_t)_Mines.size() - (std::int64_t)_Flags.size();
+}
+
+bool alone::SparseMap::won() const {
+    return _Exploded == 0 && _RevealedSafe == _Size * _Size - _Mines.size();
+}
+
+bool alone::SparseMap::lost() const {
+    return _Exploded != 0;
+}
+
+const std::pmr::vector <std::uint64_t>& alone::SparseMap::mines() const {
+    return _Mines;
+}
+
+size_t alone::SparseMap::memory() const {
+    //узлы дерева: ключ, значение и около четырёх указателей служебных данных
+    const size_t node = 6 * sizeof(std::uint64_t);
+    return _Mines.capacity() * sizeof(std::uint64_t) + (_Revealed.size() + _Flags.size()) * node +
+           _Stack.capacity() * sizeof(_Stack[0]) + _Dirty.capacity() * sizeof(Span);
+}
+
+bool alone::SparseMap::_IsMine(std::uint64_t index) const {
+    return std::binary_search(_Mines.begin(), _Mines.end(), index);
+}
+
+bool alone::SparseMap::_IsRevealed(std::uint64_t index) const {
+    auto it = _Revealed.upper_bound(index);
+    return it != _Revealed.begin() && std::prev(it)->second > index;
+}
+
+bool alone::SparseMap::_Closed(std::uint64_t x, std::uint64_t y) const {
+    std::uint64_t index = x + y * _Size;
+    return !_IsRevealed(index) && !_Flags.count(index);
+}
+
+size_t alone::SparseMap::_Around(std::uint64_t x, std::uint64_t y) const {
+    //в каждой из трёх строк бомбы соседей лежат одним отрезком номеров
+    std::uint64_t left = x == 0 ? 0 : x - 1, right = std::min(x + 1, _Size - 1);
+    size_t count = 0;
+    for (std::uint64_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < _Size; j++) {
+        auto begin = std::lower_bound(_Mines.begin(), _Mines.end(), left + j * _Size);
+        auto end = std::upper_bound(begin, _Mines.end(), right + j * _Size);
+        count += end - begin;
+    }
+    return count - _IsMine(x + y * _Size);
+}
+
+void alone::SparseMap::_Open(std::uint64_t begin, std::uint64_t end, std::uint64_t y) {
+    begin += y * _Size;
+    end += y * _Size;
+    _Dirty.emplace_back(begin, end);
+    if (end - begin == 1 && _IsMine(begin))
+        _Exploded++;
+    else
+        _RevealedSafe += end - begin;
+
+    //склейка с соседними отрезками, в том числе с концом предыдущей строки
+    auto next = _Revealed.find(end);
+    if (next != _Revealed.end()) {
+        end = next->second;
+        _Revealed.erase(next);
+    }
+    auto it = _Revealed.lower_bound(begin);
+    if (it != _Revealed.begin() && std::prev(it)->second == begin) {
+        std::prev(it)->second = end;
+        return;
+    }
+    _Revealed.emplace(begin, end);
+}
+
+void alone::SparseMap::_Flood() {
+    auto empty = [&](std::uint64_t x, std::uint64_t y) {
+        return !_IsMine(x + y * _Size) && _Around(x, y) == 0;
+    };
+
+    while (!_Stack.empty()) {
+        auto [x, y] = _Stack.back();
+        _Stack.pop_back();
+        if (!_Closed(x, y))
+            continue;
+
+        //число или бомба открываются по одной
+        if (!empty(x, y)) {
+            _Open(x, x + 1, y);
+            continue;
+        }
+
+        //самый длинный отрезок закрытых пустых клеток строки вокруг затравки
+        std::uint64_t left = x, right = x + 1;
+        while (left != 0 && _Closed(left - 1, y) && empty(left - 1, y))
+            left--;
+        while (right != _Size && _Closed(right, y) && empty(right, y))
+            right++;
+
+        //закрытые клетки по краям отрезка - это числа рядом с пустыми, бомб там нет
+        std::uint64_t begin = left != 0 && _Closed(left - 1, y) ? left - 1 : left;
+        std::uint64_t end = right != _Size && _Closed(right, y) ? right + 1 : right;
+        _Open(begin, end, y);
+
+        //в соседних строках на каждую группу закрытых пустых клеток хватит одной затравки,
+        //остальное она откроет своим отрезком, а числа добавляются по одному
+        for (std::uint64_t j : { y - 1, y + 1 }) {
+            if (j >= _Size)
+                continue;
+            bool run = false;
+            for (std::uint64_t i = left == 0 ? 0 : left - 1; i != std::min(right + 1, _Size); i++) {
+                if (!_Closed(i, j)) {
+                    run = false;
+                    continue;
+                }
+                bool blank = empty(i, j);
+                if (!blank || !run)
+                    _Stack.emplace_back(i, j);
+                run = blank;
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+//std
+#include <map>
+#include <set>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     *  карта для огромных полей с редкими бомбами, например 100000 x 100000 при 1%
+        по клетке на байт такое поле не помещается в память, поэтому здесь хранится только то, что есть:
+            бомбы - отсортированный список номеров клеток x + y * size
+            открытые клетки - непересекающиеся отрезки номеров, соседние отрезки склеиваются
+            флаги - множество номеров
+        числа не хранятся, а считаются при открытии тремя двоичными поисками по строкам вокруг клетки
+        методы те же, что у Map, только координаты 64-битные,
+        а изменения за ход - это отрезки, потому что одна заливка может открыть миллионы клеток
+     */
+    class SparseMap {
+    public:
+        /**
+         * отрезок номеров клеток [first, second)
+         */
+        using Span = std::pair <std::uint64_t, std::uint64_t>;
+
+        /**
+         * @param resource откуда берётся вся память карты, как у Map
+         */
+        explicit SparseMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        void resize(std::uint64_t size);
+
+        /**
+         *  номера бомб тянутся сразу в итоговый массив, сортируются, а повторы вытягиваются заново,
+            пока их не останется: кроме самого массива памяти не нужно, а при редких бомбах хватает пары кругов
+            (x, y) - первое нажатие, там бомбы не будет
+         */
+        void generate(std::uint64_t bombs, std::uint64_t x, std::uint64_t y, std::mt19937_64& rng);
+
+        /**
+         *  заливка идёт строками: пустые клетки открываются сразу целым отрезком строки,
+            поэтому и память, и изменения растут с периметром открытой области, а не с площадью
+         * @return true, если в клетке бомба
+         */
+        bool reveal(std::uint64_t x, std::uint64_t y);
+
+        /**
+         * @return true, если флаг поставлен
+         */
+        bool flag(std::uint64_t x, std::uint64_t y);
+
+        /**
+         * @return true, если среди открытых соседей оказалась бомба
+         */
+        bool chord(std::uint64_t x, std::uint64_t y);
+
+        /**
+         * то, что видит игрок в клетке, одним байтом из Type, как Map::visible
+         */
+        std::uint8_t visible(std::uint64_t x, std::uint64_t y) const;
+
+        /**
+         * что лежит в клетке: число, None или Bomb
+         */
+        Type content(std::uint64_t x, std::uint64_t y) const;
+
+        std::uint64_t size() const;
+        std::uint64_t revealed() const;
+        std::uint64_t correctFlags() const;
+        std::int64_t remaining() const;
+        bool won() const;
+        bool lost() const;
+
+        /**
+         * номера клеток с бомбами по возрастанию
+         */
+        const std::pmr::vector <std::uint64_t>& mines() const;
+
+        /**
+         * сколько байт примерно занимает карта
+         */
+        size_t memory() const;
+
+        /**
+         *  изменения последнего хода отрезками номеров клеток
+            очищается в начале каждого reveal, flag и chord
+         */
+        std::pmr::vector <Span> _Dirty;
+
+    private:
+        std::uint64_t _Size = 0;
+        std::pmr::vector <std::uint64_t> _Mines;
+
+        /**
+         * начало отрезка открытых клеток -> его конец
+         */
+        std::pmr::map <std::uint64_t, std::uint64_t> _Revealed;
+        std::pmr::set <std::uint64_t> _Flags;
+
+        /**
+         * затравки заливки
+         */
+        std::pmr::vector <std::pair <std::uint64_t, std::uint64_t>> _Stack;
+
+        std::uint64_t _RevealedSafe = 0;
+        std::uint64_t _CorrectFlags = 0;
+        std::uint64_t _Exploded = 0;
+
+        bool _IsMine(std::uint64_t index) const;
+        bool _IsRevealed(std::uint64_t index) const;
+
+        /**
+         * закрыта и без флага, то есть её можно открыть
+         */
+        bool _Closed(std::uint64_t x, std::uint64_t y) const;
+
+        /**
+         * бомбы вокруг клетки, сама клетка не считается
+         */
+        size_t _Around(std::uint64_t x, std::uint64_t y) const;
+
+        /**
+         * открывает отрезок строки [begin, end), все клетки в нём закрыты и без флагов
+         */
+        void _Open(std::uint64_t begin, std::uint64_t end, std::uint64_t y);
+
+        void _Flood();
+    };
+}
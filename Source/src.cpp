@@ -1,25 +1,14 @@
-//#include "src.h"
+#include "src.h"
 
-void alone::TextureManager::load(std::string config_name) {
-    std::ifstream file(config_name);
-
-    while (!file.eof()) {
-        std::string temp;
-        file >> temp;
-
-        sf::Texture texture;
-        texture.loadFromFile("assets/textures/" + temp);
-
-        _Content.emplace(temp, std::move(texture));
-    }
-}
-
-sf::Texture& alone::TextureManager::operator[](std::string key) {
-    return _Content.at(key);
-}
+//std
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
 
 void alone::StateMachine::insert(std::string key, std::shared_ptr <State> value) {
     value->_Status = State::OnCreate;
+    value->_Order = _Inserted++;
     _Content.emplace(key, value);
 }
 
@@ -39,10 +28,13 @@ void alone::StateMachine::update() {
                 it.second->onCreate();
                 it.second->_Status = State::Active;
                 break;
-            case State::Active:
+            case State::Active: {
+                //мышь переводится в координаты состояния, как будто окно всегда его размера
+                auto point = window.mapPixelToCoords(input::pixel, letterbox(it.second->resolution(), window.getSize()));
+                input::mouse = sf::Vector2i(std::floor(point.x), std::floor(point.y));
                 it.second->update();
-                it.second->draw(window, sf::RenderStates::Default);
                 break;
+            }
             case State::OnDelete:
                 it.second->onDelete();
                 onRemove.push(it.first);
@@ -54,107 +46,98 @@ void alone::StateMachine::update() {
         _Content.erase(onRemove.front());
         onRemove.pop();
     }
-}
 
-void alone::input::update() {
-    preLmb = nowLmb;
-    preRmb = nowRmb;
-    nowLmb = sf::Mouse::isButtonPressed(sf::Mouse::Left);
-    nowRmb = sf::Mouse::isButtonPressed(sf::Mouse::Right);
+    draw(window);
 }
 
-bool alone::input::isClickedLeftButton() {
-    return preLmb && !nowLmb;
+void alone::StateMachine::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    //все состояния кладут команды в одну очередь, порядок задают слои, а не порядок в контейнере
+    //у каждого состояния свой вид, поэтому очередь рисуется, когда меняется размер экрана состояния
+    //порядок обхода unordered_map не определён, поэтому состояния идут по порядку вставки
+    _Active.clear();
+    for (auto& it : _Content)
+        if (it.second->_Status == State::Active)
+            _Active.push_back(it.second.get());
+    std::sort(_Active.begin(), _Active.end(), [](const State* lhs, const State* rhs) { return lhs->_Order < rhs->_Order; });
+
+    auto saved = target.getView();
+    sf::Vector2f resolution;
+    bool pending = false;
+    auto flush = [&]() {
+        target.setView(letterbox(resolution, target.getSize()));
+        _Queue.flush(target, states);
+    };
+
+    for (auto it : _Active) {
+        if (pending && it->resolution() != resolution)
+            flush();
+        resolution = it->resolution();
+        pending = true;
+        it->submit(_Queue);
+    }
+    if (pending)
+        flush();
+    target.setView(saved);
 }
 
-bool alone::input::isClickedRightButton() {
-    return preRmb && !nowRmb;
+void alone::State::submit(RenderQueue& queue) const {
+    queue.submit(RenderQueue::Interface, *this);
 }
 
-void Map::resize(size_t level) {
-    auto& d = difficulties[level];
-
-    _Content.resize(d.size);
-    for (auto& it : _Content)
-        it.resize(d.size, { 'n', Type::None});
+sf::Vector2f alone::State::resolution() const {
+    return sf::Vector2f(450, 800);
 }
 
-void Map::generate(size_t level, sf::Vector2u point) {
-    auto& d = difficulties[level];
-    _Bombs = d.bombs;
-
-    std::set <size_t> unfilled;
-    for (size_t i = 0; i != d.size * d.size; i++)
-        unfilled.emplace(i);
-
-    unfilled.erase(point.x + point.y * d.size);
-
-    std::random_device rd;
-
-    //заполнение бомб
-    for (size_t i = 0; i != _Bombs; i++) {
-        std::uniform_int_distribution <size_t> dist(0, unfilled.size() - 1);
-        size_t pos = dist(rd);
-        //std::cout << pos << ' ';
-
-        auto it = unfilled.begin();
-        std::advance(it, pos);
-        size_t point = *it;
-        _Content[point % d.size][point / d.size] = { 'n', Type::Bomb};
-        unfilled.erase(point);
-    }
-    //std::cout << '\n';
-
-    //заполнение чиселок вокруг бомб
-    for (size_t i = 0; i != _Content.size(); i++) {
-        for (size_t j = 0; j != _Content[i].size(); j++) {
-            if (_Content[i][j].second == Type::Bomb)
-                continue;
-
-            size_t value = _DetectAround(i, j);
-            if (value != 0)
-                _Content[i][j].second = (Type)(value - 1);
-        }
-    }
+void alone::input::update() {
+    press(sf::Mouse::isButtonPressed(sf::Mouse::Left), sf::Mouse::isButtonPressed(sf::Mouse::Right),
+          sf::Mouse::isButtonPressed(sf::Mouse::Middle));
+    pixel = sf::Mouse::getPosition(window);
+    mouse = pixel;
+
+    preUndo = nowUndo;
+    preRedo = nowRedo;
+    nowUndo = window.hasFocus() && sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
+    nowRedo = window.hasFocus() && sf::Keyboard::isKeyPressed(sf::Keyboard::Y);
 }
 
-bool Map::_HasBomb(size_t x, size_t y) {
-    if (x < 0 || x >= _Content.size() || y < 0 || y >= _Content.size())
-        return false;
-    return _Content[x][y].second == Type::Bomb;
-};
+void alone::input::press(bool left, bool right, bool middle) {
+    //все кнопки были отпущены - аккорд обеими кнопками закончился
+    if (!nowLmb && !nowRmb)
+        both = false;
 
-size_t Map::_DetectAround(size_t x, size_t y) {
-    return _HasBomb(x - 1, y - 1) + _HasBomb(x, y - 1) + _HasBomb(x + 1, y - 1) +
-           _HasBomb(x - 1, y) + _HasBomb(x + 1, y) +
-           _HasBomb(x - 1, y + 1) + _HasBomb(x, y + 1) + _HasBomb(x + 1, y + 1);
-};
+    preLmb = nowLmb;
+    preRmb = nowRmb;
+    preMmb = nowMmb;
+    nowLmb = left;
+    nowRmb = right;
+    nowMmb = middle;
 
-void Map::_OpenTiles(int x, int y) {
-    if (y >= _Content.size() || y < 0 || x >= _Content.size() || x < 0)
-        return;
+    if (nowLmb && nowRmb)
+        both = true;
+}
 
-    if (_Content[x][y].first == 'r' || _Content[x][y].second != Type::None) {
-        _Content[x][y].first = 'r';
-        return;
-    }
+bool alone::input::isClickedLeftButton() {
+    return preLmb && !nowLmb && !both;
+}
 
-    _Content[x][y].first = 'r';
+bool alone::input::isClickedRightButton() {
+    return preRmb && !nowRmb && !both;
+}
 
-    _OpenTiles(x - 1, y - 1);
-    _OpenTiles(x, y - 1);
-    _OpenTiles(x + 1, y - 1);
+bool alone::input::isClickedChord() {
+    return (preMmb && !nowMmb) || (both && (preLmb || preRmb) && !nowLmb && !nowRmb);
+}
 
-    _OpenTiles(x - 1, y);
-    _OpenTiles(x + 1, y);
+bool alone::input::isClickedUndo() {
+    return preUndo && !nowUndo;
+}
 
-    _OpenTiles(x - 1, y + 1);
-    _OpenTiles(x, y + 1);
-    _OpenTiles(x + 1, y + 1);
+bool alone::input::isClickedRedo() {
+    return preRedo && !nowRedo;
 }
 
 void MenuState::update(){
-    auto mouse = sf::Mouse::getPosition(window);
+    auto mouse = alone::input::mouse;
 
     for (size_t i = 0; i != _Buttons.size(); i++) {
         auto bounds = _Buttons[i].getGlobalBounds();
@@ -166,7 +149,6 @@ void MenuState::update(){
 }
 
 void MenuState::onCreate(){
-    window.setSize(sf::Vector2u(450, 800));
     _Buttons.resize(_Params.size());
 
     for (size_t i = 0; i != _Buttons.size(); i++) {
@@ -189,8 +171,17 @@ void MenuState::draw(sf::RenderTarget& target, sf::RenderStates states) const{
         target.draw(it, states);
 }
 
+void MenuState::submit(alone::RenderQueue& queue) const{
+    for (const auto& it : _Buttons)
+        queue.submit(alone::RenderQueue::Interface, it);
+}
+
+sf::Vector2f MenuState::resolution() const{
+    return sf::Vector2f(350, 350);
+}
+
 void GameOverState::update(){
-    auto mouse = sf::Mouse::getPosition(window);
+    auto mouse = alone::input::mouse;
     auto bounds = _Exit.getGlobalBounds();
 
     if (bounds.contains(mouse.x, mouse.y) && alone::input::isClickedLeftButton()) {
@@ -209,7 +200,15 @@ void GameOverState::onCreate(){
     else
         text += "lose";
 
-    text += "\n\nYou found " + std::to_string(_BombsFound) + " bombs!";
+    //3BV/s и эффективность с двумя знаками, чтобы надпись не прыгала по ширине
+    auto fixed = [](double value) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << value;
+        return out.str();
+    };
+    text += "\n\n3BV: " + std::to_string(_Metrics.bbbv);
+    text += "\n3BV/s: " + fixed(_Seconds > 0 ? _Metrics.bbbv / _Seconds : 0);
+    text += "\nEfficiency: " + fixed(_Clicks ? 100.0 * _Metrics.bbbv / _Clicks : 0) + "%";
 
     _Label.setFont(font);
     _Exit.setFont(font);
@@ -231,7 +230,12 @@ void GameOverState::onCreate(){
 
     auto exitBounds = _Exit.getGlobalBounds();
 
-    window.setSize(sf::Vector2u(labelBounds.width + 80, labelBounds.height + 80 + exitBounds.height));
+    //окно не меняется, экран итога просто вписывается в него
+    _Resolution = sf::Vector2f(labelBounds.width + 80, labelBounds.height + 80 + exitBounds.height);
+}
+
+sf::Vector2f GameOverState::resolution() const{
+    return _Resolution;
 }
 
 void GameOverState::onDelete()
@@ -244,117 +248,121 @@ void GameOverState::draw(sf::RenderTarget& target, sf::RenderStates states) cons
     target.draw(_Exit, states);
 }
 
-void GameState::update(){
-    size_t edge_size = _GameMap->_Content.size();
-    _RenderRegion.resize(4 * edge_size * edge_size);
-
-    auto& map = _GameMap->_Content;
+void GameOverState::submit(alone::RenderQueue& queue) const{
+    queue.submit(alone::RenderQueue::Interface, _Label);
+    queue.submit(alone::RenderQueue::Interface, _Exit);
+}
 
+void GameState::update(){
     //update timer
     auto time = _Clock.getElapsedTime();
     size_t seconds = time.asSeconds();
     _TimerLabel.setString(std::to_string(seconds / 60) + ':' + std::to_string(seconds % 60));
 
     //part for clicking on map
-    auto mouse = sf::Mouse::getPosition(window);
-    bool contains = mouse.x >= 0 && mouse.x <= edge_size * 32 && mouse.y >= _InterfaceOffset && mouse.y <= edge_size * 32 + _InterfaceOffset;
-    if (contains) {
+    auto mouse = alone::input::mouse;
+    bool contains = _OnBoard(mouse);
+    //заливка прошлого нажатия открывается по кусочкам, новое нажатие сначала доводит её до конца
+    bool finished = false;
+    if (_GameMap->pending()) {
+        bool clicked = alone::input::isClickedLeftButton() || alone::input::isClickedRightButton() || alone::input::isClickedChord() ||
+                       alone::input::isClickedUndo() || alone::input::isClickedRedo();
+        if (clicked)
+            _GameMap->settle();
+        else
+            _GameMap->advance(_FloodBudget);
+
+        finished = !_GameMap->pending();
+        if (finished && _Practice)
+            _History.record(*_GameMap);
+    }
+
+    bool moved = false;
+    //этот ход открыл бомбу
+    bool exploded = false;
+    if (_Practice && (alone::input::isClickedUndo() || alone::input::isClickedRedo())) {
+        //отмена по записанным изменениям клеток, без снимков карты
+        moved = alone::input::isClickedUndo() ? _History.undo(*_GameMap) : _History.redo(*_GameMap);
+    } else if (contains) {
         auto point = sf::Vector2u(mouse.x / 32, (mouse.y - _InterfaceOffset) / 32);
-        if (alone::input::isClickedLeftButton()) {
-            if (_Revealed == 0) {
-                _GameMap->generate(_Level, point);
-                _RemainedLabel.setString("Bombs remained: " + std::to_string(_GameMap->_Bombs));
-                _Revealed++;
-
-                if (map[point.x][point.y].second == Type::None)
-                    _GameMap->_OpenTiles(point.x, point.y);
-                else
-                    map[point.x][point.y].first = 'r';
-            } else {
-                if (map[point.x][point.y].first == 'n') {
-                    if (map[point.x][point.y].second == Type::None)
-                        _GameMap->_OpenTiles(point.x, point.y);
-                    else
-                        map[point.x][point.y].first = 'r';
-
-                    if (map[point.x][point.y].second == Type::Bomb)
-                        _GameStatus = 'l';
-
-                    _Revealed++;
-                }
+        if (alone::input::isClickedChord() || alone::input::isClickedLeftButton() || alone::input::isClickedRightButton())
+            _Clicks++;
+
+        if (alone::input::isClickedChord()) {
+            exploded = _GameMap->chord(point.x, point.y);
+            moved = !_GameMap->_Dirty.empty();
+            if (moved)
+                audio.play(alone::Audio::Click);
+        } else if (alone::input::isClickedLeftButton()) {
+            //карта генерируется один раз за партию, в момент первого открытия
+            if (!_Generated) {
+                _GameMap->generate(difficulties[_Level].bombs, point.x, point.y, _Random);
+                _Generated = true;
             }
+
+            //размеченная карта открывает готовую область целиком, по частям заливаются только ленивые
+            if (_GameMap->lazy()) {
+                exploded = _GameMap->revealSliced(point.x, point.y);
+                _GameMap->advance(_FloodBudget);
+            } else
+                exploded = _GameMap->reveal(point.x, point.y);
+            moved = !_GameMap->_Dirty.empty();
+            if (moved)
+                audio.play(alone::Audio::Click);
         } else if (alone::input::isClickedRightButton()) {
-            if (map[point.x][point.y].first == 'f') {
-                map[point.x][point.y].first = 'n';
-                _RemainedLabel.setString("Bombs remained: " + std::to_string(++_GameMap->_Bombs));
-
-                if (map[point.x][point.y].second == Type::Bomb)
-                    _Flags--;
-            } else if (map[point.x][point.y].first == 'n') {
-                map[point.x][point.y].first = 'f';
-                _RemainedLabel.setString("Bombs remained: " + std::to_string(--_GameMap->_Bombs));
-
-                if (map[point.x][point.y].second == Type::Bomb)
-                    _Flags++;
-
-                if (_Flags == difficulties[_Level].bombs) {
-                    _GameStatus = 'w';
-                }
+            if (_Generated) {
+                _GameMap->flag(point.x, point.y);
+                moved = !_GameMap->_Dirty.empty();
+                if (moved)
+                    audio.play(alone::Audio::Flag);
             }
         }
+
+        //ход с незаконченной заливкой запишется, когда она закончится
+        if (moved && _Practice && !_GameMap->pending())
+            _History.record(*_GameMap);
     }
 
-//расчёт вершин для карты
-    for (size_t i = 0; i != map.size(); i++) {
-        for (size_t j = 0; j != map[i].size(); j++) {
-            auto& top_lhs = _RenderRegion[(i + j * map.size()) * 4];
-            auto& top_rhs = _RenderRegion[(i + j * map.size()) * 4 + 1];
-            auto& bot_rhs = _RenderRegion[(i + j * map.size()) * 4 + 2];
-            auto& bot_lhs = _RenderRegion[(i + j * map.size()) * 4 + 3];
-
-            size_t id = 0;
-            if (DEBUG_MODE || map[i][j].first == 'r')
-                id = (size_t)map[i][j].second;
-            else if (map[i][j].first == 'f')
-                id = (size_t)Type::Flag;
-            else
-                id = (size_t)Type::Unknown;
-
-
-            size_t idx = id % 4;
-            size_t idy = id / 4;
-
-            top_lhs.position = sf::Vector2f(i * 32, _InterfaceOffset + j * 32);
-            top_rhs.position = sf::Vector2f(i * 32 + 32, _InterfaceOffset + j * 32);
-            bot_rhs.position = sf::Vector2f(i * 32 + 32, _InterfaceOffset + j * 32 + 32);
-            bot_lhs.position = sf::Vector2f(i * 32, _InterfaceOffset + j * 32 + 32);
-
-            top_lhs.texCoords = sf::Vector2f(idx * 32.f, idy * 32.f);
-            top_rhs.texCoords = sf::Vector2f(idx * 32.f + 32, idy * 32.f);
-            bot_rhs.texCoords = sf::Vector2f(idx * 32.f + 32, idy * 32.f + 32);
-            bot_lhs.texCoords = sf::Vector2f(idx * 32.f, idy * 32.f + 32);
-        }
+    //взрыв - по самому ходу: в тренировке открытая бомба остаётся до отмены, и lost() правдив и на следующих ходах
+    if (exploded) {
+        audio.play(alone::Audio::Explosion);
+        if (!_Practice)
+            _GameStatus = 'l';
+    }
+
+    //победа по счётчикам карты - все клетки без бомб открыты, открытые в тренировке бомбы ей не мешают
+    if ((moved || finished) && !_GameMap->pending()) {
+        size_t cells = _GameMap->_Content.size() * _GameMap->_Content.size();
+        if (_GameStatus == 'a' && _GameMap->revealed() == cells - _GameMap->_Bombs)
+            _GameStatus = 'w';
+
+        _RemainedLabel.setString("Bombs remained: " + std::to_string(_GameMap->remaining()));
     }
+
+//поле рисуется шейдером из текстуры, а без шейдеров - вершинами
+    _Tiles.update(*_GameMap, DEBUG_MODE);
+
 //костыли
 
     if (_GameStatus != 'a') {
         states.erase("game");
-        states.insert("over", std::shared_ptr <State>(new GameOverState(_GameStatus == 'w', _Flags)));
+        states.insert("over", std::shared_ptr <State>(new GameOverState(_GameStatus == 'w', alone::measure(*_GameMap), _Clock.getElapsedTime().asSeconds(), _Clicks)));
     }
 }
 
 void GameState::onCreate(){
     _Clock.restart();
+    _Clicks = 0;
+    _Generated = false;
 
-    _GameMap.reset(new Map());
-    _GameMap->resize(_Level);
+    _GameMap.reset(new Map(&_Arena));
+    _GameMap->resize(difficulties[_Level].size);
 
-    _Revealed = 0;
 
     size_t edge_size = _GameMap->_Content.size();
-    window.setSize(sf::Vector2u(edge_size * 32, edge_size * 32 + _InterfaceOffset));
 
-    _Atlas = &textures["minesweeper.png"];
+    auto& region = textures[tiles_handle];
+    _Tiles.create(edge_size, region.texture, sf::Vector2f(region.rect.left, region.rect.top), sf::Vector2f(0, _InterfaceOffset));
 
     _RemainedLabel.setFont(font);
     _TimerLabel.setFont(font);
@@ -376,12 +384,75 @@ void GameState::onCreate(){
 
 void GameState::onDelete(){
     _GameMap.reset(nullptr);
+    _History.clear();
+    _Arena.release();
 }
 
 void GameState::draw(sf::RenderTarget& target, sf::RenderStates states) const{
-    states.texture = _Atlas;
-    target.draw(_RenderRegion, states);
+    target.draw(_Tiles, states);
 
     target.draw(_RemainedLabel, states);
     target.draw(_TimerLabel, states);
 }
+
+sf::Vector2f GameState::resolution() const{
+    //до onCreate карты ещё нет, размер берётся из уровня
+    size_t edge_size = difficulties[_Level].size;
+    return sf::Vector2f(edge_size * 32, edge_size * 32 + _InterfaceOffset);
+}
+
+bool GameState::_OnBoard(sf::Vector2i mouse) const {
+    //правый и нижний край поля - уже снаружи: в полосы letterbox мышь попадает ровно на край, клетки там нет
+    size_t edge_size = difficulties[_Level].size;
+    return mouse.x >= 0 && (size_t)mouse.x < edge_size * 32 &&
+           mouse.y >= (int)_InterfaceOffset && (size_t)mouse.y < edge_size * 32 + _InterfaceOffset;
+}
+
+void GameState::submit(alone::RenderQueue& queue) const{
+    queue.submit(alone::RenderQueue::Board, _Tiles);
+    queue.submit(alone::RenderQueue::Interface, _RemainedLabel);
+    queue.submit(alone::RenderQueue::Interface, _TimerLabel);
+}
+
+void LoadingState::update(){
+    if (textures.poll()) {
+        states.erase("loading");
+        states.insert("menu", std::shared_ptr <State>(new MenuState()));
+    }
+
+    float progress = textures.progress();
+    _Bar.setSize(sf::Vector2f(250 * progress, 20));
+    _Label.setString("Loading " + std::to_string((size_t)(progress * 100)) + "%");
+}
+
+void LoadingState::onCreate(){
+    _Label.setFont(font);
+    _Label.setFillColor(sf::Color::White);
+    _Label.setPosition(50, 100);
+
+    _Frame.setSize(sf::Vector2f(250, 20));
+    _Frame.setPosition(50, 150);
+    _Frame.setFillColor(sf::Color::Transparent);
+    _Frame.setOutlineColor(sf::Color::White);
+    _Frame.setOutlineThickness(1);
+
+    _Bar.setPosition(50, 150);
+    _Bar.setFillColor(sf::Color::White);
+}
+
+void LoadingState::onDelete(){
+
+}
+
+void LoadingState::draw(sf::RenderTarget& target, sf::RenderStates states) const{
+    target.draw(_Label, states);
+    target.draw(_Frame, states);
+    target.draw(_Bar, states);
+}
+
+void LoadingState::submit(alone::RenderQueue& queue) const{
+    //рамка под полоской, надпись отдельно от фигур
+    queue.submit(alone::RenderQueue::Background, _Frame);
+    queue.submit(alone::RenderQueue::Interface, _Bar);
+    queue.submit(alone::RenderQueue::Interface, _Label);
+}
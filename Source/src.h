@@ -15,21 +15,22 @@
 //sfml
 #include <SFML/Graphics.hpp>
 
+#include "textures.h"
+#include "audio.h"
+#include "map.h"
+#include "history.h"
+#include "metrics.h"
+#include "tiles.h"
+#include "render.h"
+
 #define DEBUG_MODE 0
 
-sf::RenderWindow window(sf::VideoMode(450, 800), "Minesweeper");
-sf::Font font;
+//inline, чтобы заголовок можно было подключать из нескольких файлов
+inline sf::RenderWindow window(sf::VideoMode(450, 800), "Minesweeper");
+inline sf::Font font;
+inline alone::Audio audio;
 
 namespace alone {
-    //контейнер для управления текстурками
-    class TextureManager {
-    public:
-        void load(std::string config_name);
-        sf::Texture& operator[](std::string key);
-    private:
-        std::unordered_map <std::string, sf::Texture> _Content;
-    };
-
     //базовое состояние игры, от него насследуются все остальные
     class State : public sf::Drawable {
         friend class StateMachine;
@@ -45,54 +46,60 @@ namespace alone {
         virtual void update() = 0;
         virtual void onCreate() = 0;
         virtual void onDelete() = 0;
+        //команды кадра в общую очередь, по умолчанию состояние рисуется целиком через draw в слое интерфейса
+        virtual void submit(RenderQueue& queue) const;
+        //размер экрана состояния в его собственных координатах, в окно он вписывается с полосами по краям
+        virtual sf::Vector2f resolution() const;
 
     private:
         Status _Status;
+        //номер вставки в машину, в этом порядке состояния рисуются
+        size_t _Order = 0;
     };
 
-    class StateMachine {
+    class StateMachine : public sf::Drawable {
     public:
         void insert(std::string key, std::shared_ptr <State> value);
         void erase(std::string key);
         void update();
+        //отрисовка активных состояний через общую очередь, в окно из update и в запись
+        //состояния идут в порядке вставки, так что вставленное позже рисуется поверх
+        void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const override;
     private:
         std::unordered_map <std::string, std::shared_ptr <State>> _Content;
+        size_t _Inserted = 0;
+        //активные состояния кадра по порядку вставки, память живёт между кадрами
+        mutable std::vector <const State*> _Active;
+        //команды всех активных состояний за кадр, память живёт между кадрами
+        mutable RenderQueue _Queue;
     };
 }
 
 namespace alone::input {
-    bool preLmb = false, nowLmb = false;
-    bool preRmb = false, nowRmb = false;
+    inline bool preLmb = false, nowLmb = false;
+    inline bool preRmb = false, nowRmb = false;
+    inline bool preMmb = false, nowMmb = false;
+    //Z и Y
+    inline bool preUndo = false, nowUndo = false;
+    inline bool preRedo = false, nowRedo = false;
+    //левая и правая зажаты вместе, пока не отпущены все кнопки
+    inline bool both = false;
+    //положение мыши в координатах текущего состояния, можно подставить без окна
+    inline sf::Vector2i mouse;
+    //положение мыши в пикселях окна
+    inline sf::Vector2i pixel;
 
     void update();
+    //переход кнопок мыши к новому состоянию, update берёт его у sf::Mouse, тесты подставляют сами
+    void press(bool left, bool right, bool middle = false);
     bool isClickedLeftButton();
     bool isClickedRightButton();
+    //средняя кнопка или обе сразу
+    bool isClickedChord();
+    bool isClickedUndo();
+    bool isClickedRedo();
 }
 
-//just a crutch for fast naming
-template <class _T>
-using Matrix = std::vector <std::vector <_T>>;
-
-//это для удобной нумерации текстурок
-enum class Type {
-    Number1 = 0,
-    Number2 = 1,
-    Number3,
-    Number4,
-    Number5,
-    Number6,
-    Number7,
-    Number8,
-    None,
-    Unknown,
-    Flag,
-    NoBomb,
-    NoneQuiestion,
-    UnknownQuestion,
-    Bomb,
-    RedBomb
-};
-
 //crutch
 struct difficulty_t {
     std::string name;
@@ -100,30 +107,12 @@ struct difficulty_t {
     size_t size;
 };
 
-std::array <difficulty_t, 3> difficulties;
-alone::TextureManager textures;
-alone::StateMachine states;
-
-class Map {
-    friend class GameState;
-public:
-    void resize(size_t level);
-
-    //генерация карты, включая рандомное заполнение
-    void generate(size_t level, sf::Vector2u point);
-
-    //n - unknown, r - revealed, f - flag
-    Matrix <std::pair <char, Type>> _Content;
-    size_t _Bombs;
-
-    bool _HasBomb(size_t x, size_t y);
+inline std::array <difficulty_t, 3> difficulties;
+inline alone::TextureManager textures;
 
-    size_t _DetectAround(size_t x, size_t y);
-
-    //рукурсивный алгоритм, чтобы открыть тайлы вокруг нажатого
-    //получается рекурсия только в том случае, если игрок нажимает по пустому тайлу
-    void _OpenTiles(int x, int y);
-};
+//номер картинки с тайлами, ищется один раз сразу после textures.load
+inline alone::TextureManager::Handle tiles_handle;
+inline alone::StateMachine states;
 
 class MenuState : public alone::State {
 public:
@@ -137,22 +126,34 @@ private:
 
     void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const override;
 
+    void submit(alone::RenderQueue& queue) const override;
+
+    //экран меню маленький, в окне он просто увеличивается
+    sf::Vector2f resolution() const override;
+
 private:
     std::vector <sf::Text> _Buttons;
-    std::array <std::pair <std::string, std::function <void()>>, 4> _Params;
+    std::array <std::pair <std::string, std::function <void()>>, 5> _Params;
 };
 
 class GameOverState : public alone::State {
 public:
-    GameOverState(bool status, size_t bombsFound) {
+    GameOverState(bool status, alone::BoardMetrics metrics = {}, float seconds = 0, size_t clicks = 0) {
         _Status = status;
-        _BombsFound = bombsFound;
+        _Metrics = metrics;
+        _Seconds = seconds;
+        _Clicks = clicks;
     }
 
     sf::Text _Label, _Exit;
     //1 = win, 0 = lose
     bool _Status;
-    size_t _BombsFound;
+    //сложность карты, время партии и сколько раз игрок нажал на поле
+    alone::BoardMetrics _Metrics;
+    float _Seconds;
+    size_t _Clicks;
+    //размер экрана под надписи, считается в onCreate
+    sf::Vector2f _Resolution{450, 800};
 
     void update() override;
 
@@ -164,21 +165,36 @@ public:
     void onDelete() override;
 
     void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const override;
+
+    void submit(alone::RenderQueue& queue) const override;
+
+    sf::Vector2f resolution() const override;
 };
 
 class GameState : public alone::State {
 public:
-    GameState(size_t level) {
+    GameState(size_t level, std::uint64_t seed = std::random_device{}(), bool practice = false) : _Random(seed) {
         _Level = level;
+        _Practice = practice;
     }
+    //арена партии, объявлена раньше карты и истории, сбрасывается в onDelete
+    std::pmr::monotonic_buffer_resource _Arena{64 * 1024};
     std::unique_ptr <Map> _GameMap;
     const size_t _InterfaceOffset = 100;
-    size_t _Flags = 0;
-    sf::VertexArray _RenderRegion = sf::VertexArray(sf::Quads);
-    sf::Texture* _Atlas = nullptr;
+    //клетки поля тайлами из атласа
+    alone::TileRenderer _Tiles;
     size_t _Level;
-    size_t _Revealed = 0;
+    std::mt19937_64 _Random;
+    //тренировка: ходы можно отменять, взрыв не заканчивает игру
+    bool _Practice;
+    alone::History _History{&_Arena};
     sf::Clock _Clock;
+    //нажатия на поле для эффективности: 3BV / нажатия
+    size_t _Clicks = 0;
+    //карта уже сгенерирована первым нажатием, отмена до начала партии её не сбрасывает
+    bool _Generated = false;
+    //сколько времени за кадр тратится на заливку, ноль - открывать всё сразу
+    std::chrono::microseconds _FloodBudget{2000};
     sf::Text _RemainedLabel, _TimerLabel;
     //a - active, w - win, l - lose
     char _GameStatus = 'a';
@@ -190,9 +206,34 @@ public:
     void onDelete() override;
 
     void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const override;
+
+    void submit(alone::RenderQueue& queue) const override;
+
+    sf::Vector2f resolution() const override;
+
+    //мышь в координатах состояния над клеткой поля
+    bool _OnBoard(sf::Vector2i mouse) const;
+};
+
+//первое состояние игры, пока в фоне грузятся текстурки
+class LoadingState : public alone::State {
+public:
+    void update() override;
+
+    void onCreate() override;
+
+    void onDelete() override;
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const override;
+
+    void submit(alone::RenderQueue& queue) const override;
+
+private:
+    sf::Text _Label;
+    sf::RectangleShape _Frame, _Bar;
 };
 
-MenuState::MenuState() {
+inline MenuState::MenuState() {
     _Params = {
             std::make_pair(std::string("Easy"), []() {
                 states.insert("game", std::shared_ptr <alone::State>(new GameState(0)));
@@ -206,6 +247,10 @@ MenuState::MenuState() {
                 states.insert("game", std::shared_ptr <alone::State>(new GameState(2)));
                 states.erase("menu");
             }),
+            std::make_pair(std::string("Practice"), []() {
+                states.insert("game", std::shared_ptr <alone::State>(new GameState(1, std::random_device{}(), true)));
+                states.erase("menu");
+            }),
             std::make_pair(std::string("Exit"), []() {
                 window.close();
             })
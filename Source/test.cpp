@@ -1,9 +1,28 @@
 #include <doctest.h>
 #include "src.h"
+#include "generator.h"
+#include "environment.h"
+#include "encoder.h"
+#include "delta.h"
+#include "recorder.h"
+#include "history.h"
+#include "metrics.h"
+#include "board.h"
+#include "topology.h"
+#include "sparse.h"
+#include "render.h"
+#include "parallel.h"
+#include <atomic>
+#include <filesystem>
+#include <cmath>
+#ifdef __linux__
+#include "server.h"
+#include <unistd.h>
+#endif
 
 TEST_CASE("Tesing game over state.")
 {
-    GameOverState go(true,2);
+    GameOverState go(true);
             CHECK(go._Status == true);
 }
 
@@ -16,6 +35,32 @@ TEST_CASE("Checking inputs.")
             REQUIRE(isClickedRightButton() == false);
 }
 
+TEST_CASE("Checking chord input.")
+{
+    using namespace alone::input;
+
+    //обе кнопки вместе: обычные нажатия глушатся, аккорд - когда отпущена последняя
+    press(true, true);
+    press(false, true);
+    CHECK(!isClickedLeftButton());
+    CHECK(!isClickedChord());
+    press(false, false);
+    CHECK(!isClickedRightButton());
+    CHECK(isClickedChord());
+
+    press(true, false);
+    press(false, false);
+    CHECK(isClickedLeftButton());
+    CHECK(!isClickedChord());
+
+    //средняя кнопка - аккорд сразу, левая и правая при этом не срабатывают
+    press(false, false, true);
+    press(false, false, false);
+    CHECK(isClickedChord());
+    CHECK(!isClickedLeftButton());
+    CHECK(!isClickedRightButton());
+}
+
 TEST_CASE("Testing difficulty_t.")
 {
     difficulty_t dif;
@@ -35,4 +80,1320 @@ TEST_CASE("Testing GameMap pointer.")
             REQUIRE(g._GameMap == nullptr);
     g.onDelete();
             REQUIRE(g._GameMap == nullptr);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Testing texture manager with missing config.")
+{
+    alone::TextureManager t;
+    t.load("missing/include.txt");
+            REQUIRE(t.poll() == true);
+            CHECK(t.progress() == 1.f);
+            CHECK_THROWS(t.find("minesweeper.png"));
+}
+
+TEST_CASE("Testing texture handles.")
+{
+    //своя папка: картинки ищутся рядом с конфигом, и там их точно нет
+    auto directory = std::filesystem::temp_directory_path() / "saper_texture_handles";
+    std::filesystem::create_directories(directory);
+    auto path = directory / "include.txt";
+    {
+        std::ofstream config(path);
+        config << "first.png\nsecond.png\nfirst.png\n";
+    }
+
+    alone::TextureManager t;
+    t.load(path.string());
+    auto first = t.find("first.png");
+    auto second = t.find("second.png");
+            CHECK(first != second);
+
+    while (!t.poll()) {}
+
+    //картинок нет на диске, поэтому в атлас они не попали
+    CHECK(t[first].texture == nullptr);
+    CHECK(t[second].texture == nullptr);
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Testing asset bundle round trip.")
+{
+    auto path = (std::filesystem::temp_directory_path() / "saper_test_assets.pak").string();
+            REQUIRE(alone::Bundle::write(path, {
+                    { "material/font.ttf", "font" },
+                    { "audio/mysaca.ogg", std::string(100, 'x') },
+                    { "material/textures/include.txt", "minesweeper.png" }
+            }));
+
+    alone::Bundle bundle;
+            REQUIRE(bundle.open(path));
+
+    auto font = bundle.find("material/font.ttf");
+            REQUIRE(font.size() == 4);
+            CHECK(std::string((const char*)font.data(), font.size()) == "font");
+            CHECK((size_t)font.data() % 64 == 0);
+
+            CHECK(bundle.find("audio/mysaca.ogg").size() == 100);
+            CHECK(bundle.find("material/missing.png").empty());
+            CHECK_FALSE(bundle.open("missing.pak"));
+
+    //файл отображён в память, пока бандл открыт
+    bundle.close();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Testing map generation with a seed.")
+{
+    Map a, b;
+    a.resize(10);
+    b.resize(10);
+
+    std::mt19937_64 lhs(42), rhs(42);
+    a.generate(20, 3, 4, lhs);
+    b.generate(20, 3, 4, rhs);
+            CHECK(a._Content == b._Content);
+            CHECK(a._Content[3][4].second != Type::Bomb);
+
+    size_t bombs = 0;
+    for (size_t i = 0; i != 10; i++)
+        for (size_t j = 0; j != 10; j++)
+            bombs += a._Content[i][j].second == Type::Bomb;
+    CHECK(bombs == 20);
+}
+
+TEST_CASE("Testing chord.")
+{
+    size_t size = 30;
+    for (std::uint64_t seed = 0; seed != 20; seed++) {
+        Map map;
+        map.resize(size);
+        std::mt19937_64 rng(seed);
+        map.generate(120, 0, 0, rng);
+        map.reveal(0, 0);
+
+        //ищем открытое число и ставим флаги ровно на его бомбы
+        for (size_t i = 0; i != size * size; i++) {
+            size_t x = i % size, y = i / size;
+            auto cell = map._Content[x][y];
+            if (cell.first != 'r' || cell.second > Type::Number8)
+                continue;
+
+            Map expected = map;
+            for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < size; j++)
+                for (size_t k = x == 0 ? 0 : x - 1; k <= x + 1 && k < size; k++)
+                    if (map._Content[k][j].second == Type::Bomb && map._Content[k][j].first == 'n') {
+                        map.flag(k, j);
+                        expected.flag(k, j);
+                    }
+
+            //одна заливка должна дать то же, что и открытие соседей по одному
+            size_t closed = 0;
+            for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < size; j++)
+                for (size_t k = x == 0 ? 0 : x - 1; k <= x + 1 && k < size; k++)
+                    if (expected._Content[k][j].first == 'n') {
+                        expected.reveal(k, j);
+                        closed++;
+                    }
+
+            CHECK(!map.chord(x, y));
+            CHECK(map._Content == expected._Content);
+            CHECK(map._Dirty.size() >= closed);
+            break;
+        }
+    }
+
+    //неправильный флаг: аккорд открывает бомбу
+    Map map;
+    map.resize(3);
+    map._Content.fill({ 'n', Type::None });
+    map._Content[0][0] = { 'n', Type::Bomb };
+    map._Content[1][1] = { 'r', Type::Number1 };
+    map.flag(2, 2);
+    CHECK(map.chord(1, 1));
+    CHECK(map._Content[0][0].first == 'r');
+
+    //флагов не хватает - ничего не происходит
+    map.flag(2, 2);
+    map._Content[0][0].first = 'n';
+    CHECK(!map.chord(1, 1));
+    CHECK(map._Dirty.empty());
+}
+
+TEST_CASE("Testing map counters.")
+{
+    size_t size = 16;
+    for (std::uint64_t seed = 0; seed != 10; seed++) {
+        Map map;
+        map.resize(size);
+        std::mt19937_64 rng(seed);
+        map.generate(40, 0, 0, rng);
+        map.reveal(0, 0);
+
+        //после каждого хода счётчики совпадают с полным обходом карты
+        for (size_t i = 0; i != 300 && !map.lost() && !map.won(); i++) {
+            size_t x = rng() % size, y = rng() % size;
+            bool bomb = map._Content[x][y].second == Type::Bomb;
+            if (rng() % 3 == 0 || bomb)
+                map.flag(x, y);
+            else if (rng() % 2 == 0)
+                map.chord(x, y);
+            else
+                map.reveal(x, y);
+
+            size_t revealed = 0, correct = 0, flags = 0;
+            for (size_t k = 0; k != size * size; k++) {
+                auto cell = map._Content.data()[k];
+                revealed += cell.first == 'r' && cell.second != Type::Bomb;
+                correct += cell.first == 'f' && cell.second == Type::Bomb;
+                flags += cell.first == 'f';
+            }
+            REQUIRE(map.revealed() == revealed);
+            REQUIRE(map.correctFlags() == correct);
+            REQUIRE(map.remaining() == (std::ptrdiff_t)40 - (std::ptrdiff_t)flags);
+            REQUIRE(map.won() == (revealed == size * size - 40));
+        }
+    }
+
+    //победа не требует флагов, а заливка не открывает клетки с флагами
+    Map map;
+    map.resize(4);
+    std::mt19937_64 rng(1);
+    map.generate(1, 0, 0, rng);
+    size_t bomb = 0;
+    while (map._Content.data()[bomb].second != Type::Bomb)
+        bomb++;
+
+    size_t safe = bomb == 15 ? 14 : 15;
+    map.flag(safe % 4, safe / 4);
+    map.reveal(0, 0);
+    CHECK(map._Content.data()[safe].first == 'f');
+    CHECK(!map.won());
+    map.flag(safe % 4, safe / 4);
+    map.reveal(safe % 4, safe / 4);
+    for (size_t i = 0; i != 16; i++)
+        if (i != bomb)
+            map.reveal(i % 4, i / 4);
+    CHECK(map.won());
+    CHECK(!map.lost());
+    CHECK(map.remaining() == 1);
+}
+
+TEST_CASE("Testing undo history.")
+{
+    size_t size = 16;
+    Map map;
+    map.resize(size);
+    std::mt19937_64 rng(11);
+    map.generate(40, 0, 0, rng);
+
+    alone::History history;
+    std::vector <Grid <std::pair <char, Type>>> boards = { map._Content };
+    std::vector <size_t> revealed = { 0 }, flags = { 0 };
+
+    for (size_t i = 0; boards.size() != 40; i++) {
+        size_t x = rng() % size, y = rng() % size;
+        if (rng() % 3 == 0)
+            map.flag(x, y);
+        else if (rng() % 2 == 0)
+            map.chord(x, y);
+        else
+            map.reveal(x, y);
+        if (map._Dirty.empty())
+            continue;
+
+        history.record(map);
+        boards.push_back(map._Content);
+        revealed.push_back(map.revealed());
+        flags.push_back(map.correctFlags());
+    }
+
+    //отмена до самого начала, на каждом шаге карта и счётчики как до хода
+    for (size_t i = boards.size() - 1; i != 0; i--) {
+        REQUIRE(history.undo(map));
+        REQUIRE(map._Content == boards[i - 1]);
+        CHECK(map.revealed() == revealed[i - 1]);
+        CHECK(map.correctFlags() == flags[i - 1]);
+    }
+    CHECK(!history.undo(map));
+    CHECK(!map.lost());
+
+    for (size_t i = 1; i != boards.size(); i++) {
+        REQUIRE(history.redo(map));
+        REQUIRE(map._Content == boards[i]);
+        CHECK(map.revealed() == revealed[i]);
+    }
+    CHECK(!history.redo(map));
+
+    //новый ход после отмены забывает то, что можно было повторить
+    history.undo(map);
+    history.undo(map);
+    map.flag(0, 0);
+    if (map._Dirty.empty())
+        map.flag(1, 0);
+    history.record(map);
+    CHECK(!history.redo(map));
+    CHECK(history.size() == boards.size() - 2);
+
+    //заливка большой карты занимает по 4 байта на открытую клетку
+    Map large;
+    large.resize(500);
+    large.generate(50, 0, 0, rng);
+    alone::History big;
+    large.reveal(0, 0);
+    big.record(large);
+    CHECK(big.bytes() < 8 * large._Dirty.size() + 64);
+    REQUIRE(big.undo(large));
+    CHECK(large.revealed() == 0);
+}
+
+TEST_CASE("Testing per-game arena.")
+{
+    //арена без запасного ресурса: любое выделение мимо неё упадёт
+    std::vector <std::byte> buffer(1 << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    auto previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+    for (std::uint64_t game = 0; game != 3; game++) {
+        Map map(&arena);
+        alone::History history(&arena);
+        std::mt19937_64 rng(game);
+
+        CHECK_NOTHROW(map.resize(64));
+        CHECK_NOTHROW(map.generate(400, 0, 0, rng));
+        CHECK_NOTHROW(map.reveal(0, 0));
+        CHECK_NOTHROW(history.record(map));
+        CHECK_NOTHROW(map.flag(63, 63));
+        CHECK_NOTHROW(history.record(map));
+        CHECK(history.undo(map));
+        CHECK(history.undo(map));
+        CHECK(map.revealed() == 0);
+
+        //как в GameState::onDelete: всё отпускаем и сбрасываем арену целиком
+        history.clear();
+        arena.release();
+    }
+
+    std::pmr::set_default_resource(previous);
+}
+
+TEST_CASE("Testing precomputed opening regions.")
+{
+    size_t size = 30, cells = size * size;
+    for (std::uint64_t seed = 0; seed != 10; seed++) {
+        Map map;
+        map.resize(size);
+        std::mt19937_64 rng(seed);
+        map.generate(seed * 15, 0, 0, rng);
+
+        //обычная заливка для сверки: флаги не открываются и через них она не идёт
+        auto board = map._Content;
+        auto flood = [&](size_t x, size_t y) {
+            std::vector <std::pair <size_t, size_t>> stack = { { x, y } };
+            while (!stack.empty()) {
+                auto [i, j] = stack.back();
+                stack.pop_back();
+                if (i >= size || j >= size || board[i][j].first != 'n')
+                    continue;
+                board[i][j].first = 'r';
+                if (board[i][j].second != Type::None)
+                    continue;
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++)
+                        stack.emplace_back(i + dx, j + dy);
+            }
+        };
+
+        //количество областей совпадает с подсчётом заливкой, в каждой области одна связная группа пустых клеток
+        std::vector <bool> seen(cells);
+        size_t openings = 0;
+        for (size_t i = 0; i != cells; i++) {
+            if (map._Content.data()[i].second != Type::None || seen[i])
+                continue;
+            openings++;
+            auto region = map.region(map.regionOf(i));
+            for (auto it : region)
+                if (map._Content.data()[it].second == Type::None) {
+                    CHECK(!seen[it]);
+                    seen[it] = true;
+                }
+        }
+        CHECK(map.openings() == openings);
+
+        for (size_t i = 0; i != 20; i++) {
+            size_t x = rng() % size, y = rng() % size;
+            if (map._Content[x][y].second != Type::Bomb || map._Content[x][y].first == 'f')
+                continue;
+            map.flag(x, y);
+            board[x][y].first = 'f';
+        }
+        //флаг на пустой клетке разрывает область
+        for (size_t i = 0; i != cells; i++)
+            if (map._Content.data()[i].second == Type::None && map._Content.data()[i].first == 'n' && rng() % 50 == 0) {
+                map.flag(i % size, i / size);
+                board.data()[i].first = 'f';
+            }
+
+        for (size_t i = 0; i != 100; i++) {
+            size_t x = rng() % size, y = rng() % size;
+            if (map._Content[x][y].second == Type::Bomb)
+                continue;
+            map.reveal(x, y);
+            flood(x, y);
+            REQUIRE(map._Content == board);
+        }
+    }
+}
+
+TEST_CASE("Testing more bombs than cells.")
+{
+    //бомб не больше, чем клеток без первой, в обоих режимах, и открытие первой клетки выигрывает
+    for (auto mode : { Map::Numbers::Eager, Map::Numbers::Lazy }) {
+        Map map;
+        map.numbers(mode);
+        map.resize(8);
+        std::mt19937_64 rng(1);
+        map.generate(100, 3, 4, rng);
+        CHECK(map._Bombs == 63);
+        CHECK(!map.reveal(3, 4));
+        CHECK(map.won());
+    }
+}
+
+TEST_CASE("Testing generation without regions.")
+{
+    //без разметки карта та же, а открытие обычной заливкой даёт тот же итог
+    for (std::uint64_t seed = 0; seed != 5; seed++) {
+        Map labelled, plain;
+        plain.regions(false);
+        labelled.resize(30);
+        plain.resize(30);
+        std::mt19937_64 first(seed), second(seed);
+        labelled.generate(60, 0, 0, first);
+        plain.generate(60, 0, 0, second);
+
+        REQUIRE(labelled.openings() != 0);
+        CHECK(plain.openings() == 0);
+        CHECK(plain._Content == labelled._Content);
+
+        labelled.reveal(0, 0);
+        plain.reveal(0, 0);
+        CHECK(plain._Content == labelled._Content);
+        CHECK(plain.revealed() == labelled.revealed());
+    }
+}
+
+TEST_CASE("Testing lazy numbers.")
+{
+    Map map;
+    map.resize(300);
+    std::mt19937_64 rng(4);
+    map.generate(9000, 150, 150, rng);
+    REQUIRE(map.lazy());
+    CHECK(map.openings() == 0);
+
+    size_t bombs = 0, unknown = 0;
+    for (size_t i = 0; i != 300 * 300; i++) {
+        bombs += map._Content.data()[i].second == Type::Bomb;
+        unknown += map._Content.data()[i].second == Type::Unknown;
+    }
+    CHECK(bombs == 9000);
+    CHECK(unknown == 300 * 300 - 9000);
+    CHECK(!map._HasBomb(150, 150));
+
+    //открытые клетки посчитаны правильно, а заливка остановилась только на числах
+    CHECK(!map.reveal(150, 150));
+    for (size_t x = 0; x != 300; x++)
+        for (size_t y = 0; y != 300; y++) {
+            auto cell = map._Content[x][y];
+            if (cell.first != 'r')
+                continue;
+            CHECK(map._DetectAround(x, y) == (cell.second == Type::None ? 0 : (size_t)cell.second + 1));
+            if (cell.second == Type::None)
+                for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < 300; j++)
+                    for (size_t i = x == 0 ? 0 : x - 1; i <= x + 1 && i < 300; i++)
+                        CHECK(map._Content[i][j].first == 'r');
+        }
+
+    //маленькие карты и явный режим
+    map.resize(16);
+    map.generate(40, 0, 0, rng);
+    CHECK(!map.lazy());
+    map.numbers(Map::Numbers::Lazy);
+    map.generate(40, 0, 0, rng);
+    CHECK(map.lazy());
+    map.numbers(Map::Numbers::Eager);
+    map.resize(300);
+    map.generate(9000, 0, 0, rng);
+    CHECK(!map.lazy());
+    CHECK(map.openings() != 0);
+}
+
+TEST_CASE("Testing sliced reveal.")
+{
+    //по кусочкам открывается то же, что и за раз
+    Map whole, sliced;
+    whole.resize(400);
+    sliced.resize(400);
+    std::mt19937_64 lhs(8), rhs(8);
+    whole.generate(1600, 200, 200, lhs);
+    sliced.generate(1600, 200, 200, rhs);
+
+    whole.reveal(200, 200);
+    CHECK(!sliced.revealSliced(200, 200));
+    CHECK(sliced.pending());
+    CHECK(sliced.revealed() == 1);
+
+    size_t frames = 0;
+    while (!sliced.advance(std::chrono::microseconds(50)))
+        frames++;
+    CHECK(frames != 0);
+    CHECK(sliced._Content == whole._Content);
+    CHECK(sliced.revealed() == whole.revealed());
+    CHECK(sliced._Dirty.size() == whole._Dirty.size());
+
+    //следующий ход сначала доделывает заливку
+    whole.flag(0, 0);
+    sliced.resize(400);
+    rhs.seed(8);
+    sliced.generate(1600, 200, 200, rhs);
+    sliced.revealSliced(200, 200);
+    sliced.advance(std::chrono::microseconds(1));
+    sliced.flag(0, 0);
+    CHECK(!sliced.pending());
+    CHECK(sliced._Content == whole._Content);
+
+    //нулевой бюджет открывает всё сразу
+    sliced.generate(1600, 200, 200, rhs);
+    sliced.revealSliced(200, 200);
+    CHECK(sliced.advance({}));
+    CHECK(!sliced.pending());
+
+    //на уровне игры с размеченными областями заливка тоже идёт по клетке, а не областью целиком
+    Map easy, preset;
+    easy.resize(20);
+    preset.resize(20);
+    lhs.seed(2);
+    rhs.seed(2);
+    easy.generate(30, 10, 10, lhs);
+    preset.generate(30, 10, 10, rhs);
+    REQUIRE(preset.openings() != 0);
+    REQUIRE(preset.regionOf(10 + 10 * 20) != Map::NoRegion);
+
+    easy.reveal(10, 10);
+    REQUIRE(easy.revealed() > 1);
+    preset.revealSliced(10, 10);
+    CHECK(preset.pending());
+    CHECK(preset.revealed() == 1);
+    CHECK(!preset.won());
+
+    //шаг advance по размеру больше области, поэтому один кадр открывает её всю
+    CHECK(preset.advance(std::chrono::microseconds(1000000)));
+    CHECK(preset._Content == easy._Content);
+    CHECK(preset.revealed() == easy.revealed());
+}
+
+TEST_CASE("Testing fixed size boards.")
+{
+    //рамка не даёт выйти за поле, поэтому подсчёт совпадает с проверками границ
+    alone::Board <8, 8> fixed;
+    alone::Board <alone::DynamicSize, alone::DynamicSize> dynamic(8, 8);
+    Map map;
+    map.resize(8);
+    std::mt19937_64 rng(11);
+    map.generate(20, 0, 0, rng);
+    for (size_t x = 0; x != 8; x++)
+        for (size_t y = 0; y != 8; y++)
+            if (map._HasBomb(x, y)) {
+                fixed.place(x, y);
+                dynamic.place(x, y);
+            }
+    for (size_t x = 0; x != 8; x++)
+        for (size_t y = 0; y != 8; y++) {
+            CHECK(fixed.around(x, y) == map._DetectAround(x, y));
+            CHECK(dynamic.around(x, y) == map._DetectAround(x, y));
+        }
+
+    //после resize доска пустая, даже если память осталась от прошлого размера
+    dynamic.resize(5, 5);
+    for (size_t x = 0; x != 5; x++)
+        for (size_t y = 0; y != 5; y++)
+            CHECK(dynamic.around(x, y) == 0);
+
+    //размеры уровней и свой размер дают правильные числа, общая доска карты переживает смену размера
+    for (size_t size : { 8, 9, 10, 20, 33, 9 }) {
+        map.resize(size);
+        map.generate(size * size / 6, size / 2, size / 2, rng);
+        for (size_t x = 0; x != size; x++)
+            for (size_t y = 0; y != size; y++) {
+                auto type = map._Content[x][y].second;
+                if (type == Type::Bomb)
+                    continue;
+                CHECK(map._DetectAround(x, y) == (type == Type::None ? 0 : (size_t)type + 1));
+            }
+    }
+}
+
+TEST_CASE("Testing board topologies.")
+{
+    //квадрат совпадает с обычной картой: та же генерация и та же заливка
+    for (std::uint64_t seed = 0; seed != 5; seed++) {
+        Map map;
+        map.resize(16);
+        alone::Field <alone::topology::Square> field(alone::topology::Square(16, 16));
+        std::mt19937_64 lhs(seed), rhs(seed);
+        map.generate(40, 3, 5, lhs);
+        field.generate(40, 3 + 5 * 16, rhs);
+
+        for (size_t i = 0; i != 256; i++) {
+            auto type = map._Content.data()[i].second;
+            CHECK(field.around(i) == (type == Type::Bomb ? field.Mine : type == Type::None ? 0 : (size_t)type + 1));
+        }
+
+        map.reveal(3, 5);
+        field.reveal(3 + 5 * 16);
+        CHECK(field.revealed() == map.revealed());
+        for (size_t i = 0; i != 256; i++)
+            CHECK(field.state(i) == map._Content.data()[i].first);
+    }
+
+    //у тора у каждой клетки 8 соседей, даже в углу
+    alone::topology::Torus torus(5, 4);
+    size_t count = 0;
+    torus.neighbours(0, [&](size_t) { count++; });
+    CHECK(count == 8);
+
+    alone::topology::Hex hex(5, 5);
+    std::vector <size_t> around;
+    hex.neighbours(2 + 2 * 5, [&](size_t i) { around.push_back(i); });
+    CHECK(around == std::vector <size_t>{ 1 + 1 * 5, 2 + 1 * 5, 1 + 2 * 5, 3 + 2 * 5, 1 + 3 * 5, 2 + 3 * 5 });
+    around.clear();
+    hex.neighbours(2 + 1 * 5, [&](size_t i) { around.push_back(i); });
+    CHECK(around == std::vector <size_t>{ 2, 3, 1 + 1 * 5, 3 + 1 * 5, 2 + 2 * 5, 3 + 2 * 5 });
+
+    alone::topology::Cube cube(3, 3, 3);
+    count = 0;
+    cube.neighbours(13, [&](size_t) { count++; });
+    CHECK(count == 26);
+
+    //одна бомба в кубе не у угла: первое открытие с угла открывает всё остальное
+    alone::Field <alone::topology::Cube> space(alone::topology::Cube(4, 4, 4));
+    std::mt19937_64 rng(3);
+    space.generate(1, 0, rng);
+    size_t mines = 0;
+    for (size_t i = 0; i != space.cells(); i++)
+        mines += space.around(i) == space.Mine;
+    CHECK(mines == 1);
+    space.reveal(0);
+    CHECK(space.won());
+
+    alone::Field <alone::topology::Torus> ring(torus);
+    ring.generate(3, 0, rng);
+    for (size_t i = 0; i != ring.cells(); i++)
+        if (ring.around(i) != ring.Mine)
+            ring.reveal(i);
+    CHECK(ring.won());
+    CHECK(!ring.lost());
+}
+
+namespace {
+    /**
+     * ресурс, который запоминает наибольший объём одновременно выделенной памяти
+     */
+    struct Peak : std::pmr::memory_resource {
+        size_t current = 0, peak = 0;
+
+        void* do_allocate(size_t bytes, size_t align) override {
+            current += bytes;
+            peak = std::max(peak, current);
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+
+        void do_deallocate(void* pointer, size_t bytes, size_t align) override {
+            current -= bytes;
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+
+TEST_CASE("Testing sparse board.")
+{
+    //на обычном поле с теми же бомбами открывается то же самое
+    for (std::uint64_t seed = 0; seed != 6; seed++) {
+        size_t size = 40;
+        alone::SparseMap sparse;
+        sparse.resize(size);
+        std::mt19937_64 rng(seed);
+        sparse.generate(seed * 40, 7, 9, rng);
+        REQUIRE(sparse.mines().size() == seed * 40);
+        CHECK(!std::binary_search(sparse.mines().begin(), sparse.mines().end(), 7 + 9 * size));
+
+        Map map;
+        map.resize(size);
+        map._Bombs = sparse.mines().size();
+        for (auto it : sparse.mines())
+            map._Content.data()[it].second = Type::Bomb;
+        for (size_t x = 0; x != size; x++)
+            for (size_t y = 0; y != size; y++)
+                if (map._Content[x][y].second != Type::Bomb && map._DetectAround(x, y) != 0)
+                    map._Content[x][y].second = (Type)(map._DetectAround(x, y) - 1);
+
+        for (size_t i = 0; i != 30; i++) {
+            size_t x = rng() % size, y = rng() % size;
+            if (i % 3 == 0) {
+                CHECK(sparse.flag(x, y) == map.flag(x, y));
+            } else if (map._Content[x][y].second != Type::Bomb) {
+                sparse.reveal(x, y);
+                map.reveal(x, y);
+            }
+            CHECK(sparse.revealed() == map.revealed());
+            CHECK(sparse.correctFlags() == map.correctFlags());
+            CHECK(sparse.remaining() == map.remaining());
+        }
+        for (size_t i = 0; i != size * size; i++)
+            REQUIRE(sparse.visible(i % size, i / size) == map.visible(i));
+        CHECK(sparse.reveal(sparse.mines().empty() ? 0 : sparse.mines()[0] % size, sparse.mines().empty() ? 0 : sparse.mines()[0] / size) == !sparse.mines().empty());
+    }
+
+    //большое поле: первое нажатие открывает почти всё, а памяти уходит меньше байта на клетку
+    //считается пик всех выделений, а не только то, что осталось после хода
+    Peak peak;
+    alone::SparseMap huge(&peak);
+    huge.resize(3000);
+    std::mt19937_64 rng(1);
+    huge.generate(9000, 1500, 1500, rng);
+    huge.reveal(1500, 1500);
+    CHECK(huge.revealed() > 3000 * 3000 / 2);
+    CHECK(!huge.lost());
+    CHECK(huge.memory() < 3000 * 3000);
+    CHECK(peak.peak < 3000 * 3000);
+
+    size_t dirty = 0;
+    for (auto [begin, end] : huge._Dirty)
+        dirty += end - begin;
+    CHECK(dirty == huge.revealed());
+
+    //1% бомб на поле в сто миллионов клеток: на генерацию уходит только сам список бомб
+    Peak generation;
+    alone::SparseMap dense(&generation);
+    dense.resize(10000);
+    dense.generate(1000000, 0, 0, rng);
+    REQUIRE(dense.mines().size() == 1000000);
+    CHECK(std::adjacent_find(dense.mines().begin(), dense.mines().end(), std::greater_equal <>()) == dense.mines().end());
+    CHECK(dense.mines().front() != 0);
+    CHECK(generation.peak == 1000000 * sizeof(std::uint64_t));
+}
+
+TEST_CASE("Testing render queue batching.")
+{
+    sf::RenderTexture target;
+    REQUIRE(target.create(64, 64));
+
+    sf::Texture atlas, other;
+    REQUIRE(atlas.create(8, 8));
+    REQUIRE(other.create(8, 8));
+    sf::Vertex quad[4] = { sf::Vector2f(0, 0), sf::Vector2f(8, 0), sf::Vector2f(8, 8), sf::Vector2f(0, 8) };
+
+    alone::RenderQueue queue;
+    //три надписи одного шрифта и размера - один вызов, квадраты с одной текстурой склеиваются, даже если между ними был другой
+    sf::Text first("one", font, 20), second("two", font, 20), third("three", font, 20);
+    queue.submit(alone::RenderQueue::Interface, first);
+    queue.submit(alone::RenderQueue::Board, quad, 4, sf::Quads, &atlas);
+    queue.submit(alone::RenderQueue::Interface, second);
+    queue.submit(alone::RenderQueue::Board, quad, 4, sf::Quads, &other);
+    queue.submit(alone::RenderQueue::Board, quad, 4, sf::Quads, &atlas);
+    queue.submit(alone::RenderQueue::Interface, third);
+    queue.flush(target);
+    CHECK(queue.batches() == 3);
+
+    //полосы не склеиваются, отдельные объекты рисуются сами
+    sf::RectangleShape shape(sf::Vector2f(4, 4));
+    queue.submit(alone::RenderQueue::Board, quad, 4, sf::TriangleFan, &atlas);
+    queue.submit(alone::RenderQueue::Board, quad, 4, sf::TriangleFan, &atlas);
+    queue.submit(alone::RenderQueue::Overlay, shape);
+    queue.flush(target);
+    CHECK(queue.batches() == 3);
+
+    queue.flush(target);
+    CHECK(queue.batches() == 0);
+
+    //текстуры слоя рисуются в порядке первого добавления за кадр, а не по адресам
+    struct Probe : sf::Drawable {
+        std::vector <int>* log;
+        int id;
+        Probe(std::vector <int>* log, int id) : log(log), id(id) {}
+        void draw(sf::RenderTarget&, sf::RenderStates) const override { log->push_back(id); }
+    };
+    std::vector <int> log;
+    Probe lhs(&log, 1), rhs(&log, 2);
+    sf::RenderStates atlasStates(&atlas), otherStates(&other);
+
+    queue.submit(alone::RenderQueue::Board, lhs, atlasStates);
+    queue.submit(alone::RenderQueue::Board, rhs, otherStates);
+    queue.submit(alone::RenderQueue::Board, lhs, atlasStates);
+    queue.flush(target);
+    CHECK(log == std::vector <int>{ 1, 1, 2 });
+
+    log.clear();
+    queue.submit(alone::RenderQueue::Board, rhs, otherStates);
+    queue.submit(alone::RenderQueue::Board, lhs, atlasStates);
+    queue.flush(target);
+    CHECK(log == std::vector <int>{ 2, 1 });
+}
+
+TEST_CASE("Testing state draw order.")
+{
+    //состояния рисуются в порядке вставки, как бы их ни разложил unordered_map
+    struct Probe : alone::State {
+        std::vector <int>* log;
+        int id;
+        Probe(std::vector <int>* log, int id) : log(log), id(id) {}
+        void update() override {}
+        void onCreate() override {}
+        void onDelete() override {}
+        void draw(sf::RenderTarget&, sf::RenderStates) const override {}
+        void submit(alone::RenderQueue&) const override { log->push_back(id); }
+        sf::Vector2f resolution() const override { return id % 2 ? sf::Vector2f(320, 420) : sf::Vector2f(450, 800); }
+    };
+
+    std::vector <int> log;
+    alone::StateMachine machine;
+    for (int i = 0; i != 12; i++)
+        machine.insert("state" + std::to_string(i), std::make_shared <Probe>(&log, i));
+    machine.update();
+
+    log.clear();
+    sf::RenderTexture target;
+    REQUIRE(target.create(64, 64));
+    machine.draw(target);
+    CHECK(log == std::vector <int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 });
+}
+
+TEST_CASE("Testing letterbox views.")
+{
+    //экран игры 320x420 в окне 450x800: растягивается по ширине, полосы сверху и снизу
+    auto view = alone::letterbox(sf::Vector2f(320, 420), sf::Vector2u(450, 800));
+    CHECK(view.getSize() == sf::Vector2f(320, 420));
+    CHECK(view.getViewport().width == doctest::Approx(1));
+    CHECK(view.getViewport().height == doctest::Approx(420 * 450 / 320.f / 800));
+    CHECK(view.getViewport().top == doctest::Approx((1 - view.getViewport().height) / 2));
+
+    //широкое окно: полосы по бокам
+    view = alone::letterbox(sf::Vector2f(450, 800), sf::Vector2u(1600, 800));
+    CHECK(view.getViewport().height == doctest::Approx(1));
+    CHECK(view.getViewport().width == doctest::Approx(450 / 1600.f));
+    CHECK(view.getViewport().left == doctest::Approx((1 - 450 / 1600.f) / 2));
+
+    //свёрнутое окно не ломает вид
+    view = alone::letterbox(sf::Vector2f(450, 800), sf::Vector2u(0, 0));
+    CHECK(view.getViewport().width == doctest::Approx(1));
+}
+
+TEST_CASE("Testing board bounds under letterbox bars.")
+{
+    //средний уровень 320x420 в окне 450x800: первая строка пикселей нижней полосы попадает ровно на край поля
+    auto saved = difficulties[1];
+    difficulties[1] = { "Medium", 10, 10 };
+    GameState game(1);
+    auto resolution = game.resolution();
+    auto view = alone::letterbox(resolution, sf::Vector2u(450, 800));
+
+    //то же, что делает mapPixelToCoords для вида без поворота
+    int row = 696;
+    float y = (row - view.getViewport().top * 800) / (view.getViewport().height * 800) * resolution.y;
+    sf::Vector2i mouse(160, (int)std::floor(y));
+    CHECK(mouse.y == 420);
+    CHECK_FALSE(game._OnBoard(mouse));
+
+    CHECK(game._OnBoard(sf::Vector2i(160, 419)));
+    CHECK(game._OnBoard(sf::Vector2i(0, 100)));
+    CHECK_FALSE(game._OnBoard(sf::Vector2i(320, 200)));
+    CHECK_FALSE(game._OnBoard(sf::Vector2i(160, 99)));
+    difficulties[1] = saved;
+}
+
+TEST_CASE("Testing board metrics.")
+{
+    alone::Metrics metrics;
+
+    //бомба в центре: одни числа вокруг, пустых клеток нет
+    std::uint8_t center[2] = { 1 << 4, 0 };
+    auto result = metrics.measure(center, 3);
+    CHECK(result.bbbv == 8);
+    CHECK(result.openings == 0);
+    CHECK(result.islands == 1);
+    CHECK(result.mines == 1);
+
+    //бомба в углу: все числа на границе одной области
+    std::uint8_t corner[4] = { 1, 0, 0, 0 };
+    result = metrics.measure(corner, 5);
+    CHECK(result.bbbv == 1);
+    CHECK(result.openings == 1);
+    CHECK(result.islands == 0);
+    CHECK(result.density == doctest::Approx(1.0 / 25));
+
+    //на картах игры совпадает с разметкой областей и с упакованной картой
+    alone::BatchConfig config;
+    config.size = 16;
+    config.bombs = 40;
+    config.x = config.y = 8;
+    config.seed = 5;
+    auto boards = alone::generateBoards(config, 3000);
+    auto batch = alone::measureBoards(boards, config.size, 4);
+    REQUIRE(batch.size() == 3000);
+    CHECK(alone::measureBoards(boards, config.size, 1)[2999].bbbv == batch[2999].bbbv);
+
+    Map map;
+    map.resize(config.size);
+    std::mt19937_64 rng(alone::streamSeed(config.seed, 0));
+    for (size_t i = 0; i != 20; i++) {
+        map.generate(config.bombs, config.x, config.y, rng);
+        auto single = alone::measure(map);
+        CHECK(single.openings == map.openings());
+        CHECK(single.mines == config.bombs);
+        CHECK(single.bbbv == batch[i].bbbv);
+        CHECK(single.islands == batch[i].islands);
+
+        //3BV - это столько нажатий, сколько нужно, если жать по областям, а потом по оставшимся числам
+        size_t clicks = 0;
+        for (size_t pass = 0; pass != 2; pass++)
+            for (size_t j = 0; j != config.size * config.size; j++) {
+                auto& cell = map._Content.data()[j];
+                if (cell.first == 'n' && cell.second != Type::Bomb && (pass == 1 || cell.second == Type::None)) {
+                    map.reveal(j % config.size, j / config.size);
+                    clicks++;
+                }
+            }
+        CHECK(map.won());
+        CHECK(clicks == single.bbbv);
+    }
+}
+
+TEST_CASE("Testing batch board generator.")
+{
+    alone::BatchConfig config;
+    config.size = 10;
+    config.bombs = 20;
+    config.x = 5;
+    config.y = 5;
+    config.seed = 7;
+
+    config.threads = 1;
+    auto single = alone::generateBoards(config, 3000);
+    config.threads = 4;
+    auto multi = alone::generateBoards(config, 3000);
+            //результат не зависит от количества потоков
+            REQUIRE(single == multi);
+
+    size_t bytes = alone::packedBoardSize(config.size);
+    for (size_t i = 0; i != 3000; i++) {
+        size_t bombs = 0;
+        for (size_t x = 0; x != config.size; x++)
+            for (size_t y = 0; y != config.size; y++)
+                bombs += alone::packedHasBomb(single.data() + i * bytes, config.size, x, y);
+        REQUIRE(bombs == config.bombs);
+        REQUIRE_FALSE(alone::packedHasBomb(single.data() + i * bytes, config.size, 5, 5));
+    }
+
+    auto path = (std::filesystem::temp_directory_path() / "saper_test_boards.bin").string();
+    REQUIRE(alone::generateBoards(config, 3000, path));
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector <std::uint8_t> stored((std::istreambuf_iterator <char>(file)), std::istreambuf_iterator <char>());
+            CHECK(stored == single);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Testing learning environment.")
+{
+    alone::Environment env(8, 10);
+    std::vector <std::uint8_t> observation(env.cells());
+    env.reset(1, observation.data());
+    CHECK(observation[0] == (std::uint8_t)Type::Unknown);
+
+    //флаг до первого открытия ничего не делает
+    auto result = env.step(env.cells(), observation.data());
+    CHECK(result.reward < 0);
+    CHECK_FALSE(result.done);
+
+    //первое открытие всегда безопасно
+    result = env.step(0, observation.data());
+    CHECK(result.reward > 0);
+    CHECK(observation[0] != (std::uint8_t)Type::Unknown);
+    CHECK(observation[0] != (std::uint8_t)Type::Bomb);
+
+    //повторное открытие той же клетки - пустой ход
+    result = env.step(0, observation.data());
+    CHECK(result.reward < 0);
+}
+
+TEST_CASE("Testing vectorized environment.")
+{
+    alone::VectorEnvironment lhs(300, 8, 10, 1), rhs(300, 8, 10, 3);
+    size_t cells = lhs.cells();
+
+    std::vector <std::uint8_t> lhsObs(300 * cells), rhsObs(300 * cells);
+    std::vector <float> lhsRewards(300), rhsRewards(300);
+    std::vector <std::uint8_t> lhsDones(300), rhsDones(300);
+    std::vector <std::uint32_t> actions(300);
+
+    lhs.reset(5, lhsObs.data());
+    rhs.reset(5, rhsObs.data());
+
+    size_t finished = 0;
+    std::mt19937 rng(3);
+    for (size_t step = 0; step != 200; step++) {
+        for (auto& it : actions)
+            it = rng() % cells;
+
+        lhs.step(actions.data(), lhsObs.data(), lhsRewards.data(), lhsDones.data());
+        rhs.step(actions.data(), rhsObs.data(), rhsRewards.data(), rhsDones.data());
+        for (auto it : lhsDones)
+            finished += it;
+    }
+
+    //прогон не зависит от количества потоков
+    CHECK(lhsObs == rhsObs);
+    CHECK(lhsRewards == rhsRewards);
+    CHECK(finished > 0);
+}
+
+TEST_CASE("Testing thread pool reuse.")
+{
+    alone::ThreadPool pool(4);
+    CHECK(pool.size() == 4);
+
+    //одни и те же потоки много раз подряд, каждая задача выполняется ровно один раз
+    std::vector <std::atomic <int>> hits(1000);
+    std::atomic <bool> threads = true;
+    bool once = true;
+    for (size_t round = 0; round != 500; round++) {
+        size_t count = 1 + round * 37 % hits.size();
+        for (auto& it : hits)
+            it = 0;
+
+        pool.run(count, [&](size_t job, size_t thread) {
+            hits[job]++;
+            if (thread >= pool.size())
+                threads = false;
+        });
+
+        for (size_t i = 0; i != hits.size(); i++)
+            once = once && hits[i] == (i < count ? 1 : 0);
+    }
+    CHECK(once);
+    CHECK(threads);
+
+    pool.run(0, [&](size_t job, size_t) { hits[job]++; });
+}
+
+TEST_CASE("Testing observation encoder.")
+{
+    for (size_t size : { 9, 20 }) {
+        Map map;
+        map.resize(size);
+        std::mt19937_64 rng(size);
+        map.generate(size * size / 8, 0, 0, rng);
+        map.reveal(0, 0);
+
+        alone::Encoder encoder;
+        size_t cells = size * size;
+        std::vector <std::uint8_t> full(alone::Encoder::PlaneCount * cells), step(full.size());
+        encoder.encode(map, step.data());
+
+        //несколько ходов, после каждого обновлённые плоскости должны совпадать с полным кодированием
+        for (size_t i = 0; i != 30; i++) {
+            size_t x = rng() % size, y = rng() % size;
+            if (i % 3 == 0)
+                map.flag(x, y);
+            else if (map._Content[x][y].second != Type::Bomb)
+                map.reveal(x, y);
+
+            encoder.update(map, step.data());
+            encoder.encode(map, full.data());
+            REQUIRE(step == full);
+        }
+
+        //проверка самих признаков на одной клетке
+        size_t x = 0, y = 0, i = x + y * size;
+        auto cell = map._Content[x][y];
+        CHECK(full[alone::Encoder::Revealed * cells + i] == 1);
+        size_t value = cell.second == Type::None ? 0 : (size_t)cell.second + 1;
+        CHECK(full[(alone::Encoder::Number0 + value) * cells + i] == 1);
+        CHECK(full[alone::Encoder::Frontier * cells + i] == 0);
+    }
+}
+
+TEST_CASE("Testing delta board sync.")
+{
+    //самая большая карта протокола почти без бомб: заливка открывает почти всё поле
+    size_t size = alone::MaxSize, cells = size * size;
+    Map map;
+    map.resize(size);
+    std::mt19937_64 rng(5);
+    map.generate(80, 0, 0, rng);
+
+    alone::DeltaEncoder encoder(4);
+    alone::DeltaDecoder decoder;
+    std::string message;
+
+    //первое сообщение - ключевой кадр с закрытой картой
+    encoder.encode(map, message);
+    REQUIRE(decoder.apply(message));
+    CHECK(message[0] == 'k');
+
+    map.reveal(0, 0);
+    size_t revealed = map._Dirty.size();
+    message.clear();
+    encoder.encode(map, message);
+    CHECK(message[0] == 'd');
+    REQUIRE(decoder.apply(message));
+    CHECK(revealed > cells / 2);
+    CHECK(message.size() < 16 * 1024);
+    CHECK(message.size() < revealed / 10);
+
+    auto same = [&] {
+        for (size_t i = 0; i != cells; i++)
+            if (decoder.board()[i] != map.visible(i))
+                return false;
+        return true;
+    };
+    CHECK(same());
+
+    //пропущенное сообщение: зритель ждёт ключевого кадра
+    map.flag(1, 0);
+    message.clear();
+    encoder.encode(map, message);
+    map.flag(2, 0);
+    message.clear();
+    encoder.encode(map, message);
+    CHECK(!decoder.apply(message));
+    CHECK(!decoder.synced());
+
+    //пятое по счёту - снова ключевое
+    map.flag(3, 0);
+    message.clear();
+    encoder.encode(map, message);
+    CHECK(message[0] == 'k');
+    REQUIRE(decoder.apply(message));
+    CHECK(same());
+
+    //ключевой кадр вне очереди не сбивает нумерацию
+    alone::DeltaDecoder late;
+    message.clear();
+    encoder.keyframe(map, message);
+    REQUIRE(late.apply(message));
+    map.flag(5, 0);
+    message.clear();
+    encoder.encode(map, message);
+    CHECK(late.apply(message));
+    CHECK(decoder.apply(message));
+    CHECK(late.board() == decoder.board());
+
+    //битые сообщения не применяются и не трогают карту, даже ключевые кадры другого размера
+    auto before = decoder.board();
+    CHECK(!decoder.apply(""));
+    CHECK(!decoder.apply(message.substr(0, message.size() - 1)));
+    CHECK(!decoder.apply(message + 'x'));
+
+    Map small;
+    small.resize(9);
+    small.generate(10, 4, 4, rng);
+    small.reveal(4, 4);
+    std::string key;
+    alone::DeltaEncoder(0).keyframe(small, key);
+    CHECK(!decoder.apply(key.substr(0, key.size() - 1)));
+    CHECK(decoder.size() == size);
+    CHECK(decoder.board() == before);
+
+    //карта больше протокольной не принимается
+    Map huge;
+    huge.resize(alone::MaxSize + 1);
+    key.clear();
+    alone::DeltaEncoder(0).keyframe(huge, key);
+    CHECK(!decoder.apply(key));
+    CHECK(decoder.board() == before);
+    CHECK(!decoder.synced());
+}
+
+TEST_CASE("Testing raw frame sink.")
+{
+    auto path = (std::filesystem::temp_directory_path() / "saper_test_frames.raw").string();
+    {
+        alone::FrameSink sink(path, alone::FrameSink::Raw, 16);
+        for (std::uint8_t i = 0; i != 3; i++) {
+            sf::Image frame;
+            frame.create(4, 2, sf::Color(i, i, i));
+            CHECK(sink.push(std::move(frame)));
+        }
+    }
+
+    //деструктор дописывает очередь, кадры лежат подряд в порядке отправки
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator <char>(file), std::istreambuf_iterator <char>());
+    }
+    std::filesystem::remove(path);
+
+    REQUIRE(content.size() == 3 * 4 * 2 * 4);
+    for (size_t i = 0; i != 3; i++)
+        CHECK(content[i * 32] == (char)i);
+
+    //по полной очереди запись пропускает кадр, не читая его из видеопамяти, и считает его выброшенным
+    {
+        alone::FrameSink sink(path, alone::FrameSink::Raw, 0);
+        CHECK(sink.full());
+        sink.drop();
+        CHECK_FALSE(sink.push(sf::Image()));
+        CHECK(sink.dropped() == 2);
+        CHECK(sink.written() == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+#ifdef __linux__
+TEST_CASE("Testing race boards.")
+{
+    //игрок на общем раскладе открывает то же, что и своя копия карты, с флагами и без
+    for (std::uint64_t seed = 0; seed != 5; seed++) {
+        auto layout = std::make_shared <Map>();
+        layout->resize(16);
+        std::mt19937_64 rng(seed);
+        layout->generate(40, 8, 8, rng);
+
+        Map own = *layout;
+        alone::RaceBoard race(layout);
+        for (size_t i = 0; i != 60 && !own.lost() && !own.won(); i++) {
+            size_t x = rng() % 16, y = rng() % 16;
+            if (i % 4 == 3) {
+                CHECK(race.flag(x, y) == own.flag(x, y));
+            } else {
+                CHECK(race.reveal(x, y) == own.reveal(x, y));
+            }
+            CHECK(race.revealed() == own.revealed());
+            CHECK(race.won() == own.won());
+            CHECK(race.lost() == own.lost());
+            for (size_t k = 0; k != 16 * 16; k++)
+                REQUIRE(race.visible(k) == own.visible(k));
+        }
+
+        //сам расклад игроки не трогают
+        CHECK(layout->revealed() == 0);
+    }
+}
+
+TEST_CASE("Testing race server.")
+{
+    std::string path = "/tmp/saper_test_" + std::to_string(getpid()) + ".sock";
+    alone::Server server;
+    REQUIRE(server.listen(path));
+
+    auto pump = [&] {
+        for (size_t i = 0; i != 4; i++)
+            server.poll(5);
+    };
+
+    alone::Client first, second;
+    REQUIRE(first.connect(path));
+    REQUIRE(second.connect(path));
+    REQUIRE(first.send(alone::protocol::join(7, 42, 16, 40)));
+    REQUIRE(second.send(alone::protocol::join(7, 0, 0, 0)));
+    pump();
+
+    for (auto client : { &first, &second }) {
+        auto joined = client->receive(100);
+        REQUIRE(joined);
+        alone::protocol::Reader reader{ *joined };
+        CHECK(reader.read(1) == alone::protocol::Joined);
+        reader.read(4);
+        CHECK(reader.read(2) == 16);
+        CHECK(reader.read(4) == 40);
+    }
+    CHECK(server.games() == 1);
+
+    //сервер должен открыть то же самое, что и локальная карта с тем же зерном
+    Map map;
+    map.resize(16);
+    std::mt19937_64 rng(42);
+    map.generate(40, 8, 8, rng);
+    map.reveal(8, 8);
+
+    REQUIRE(first.send(alone::protocol::reveal(8, 8)));
+    pump();
+
+    for (auto client : { &first, &second }) {
+        auto diff = client->receive(100);
+        REQUIRE(diff);
+        alone::protocol::Reader reader{ *diff };
+        CHECK(reader.read(1) == alone::protocol::Diff);
+        CHECK(reader.read(4) == 0);
+        CHECK(reader.read(1) == 'a');
+        size_t length = reader.read(4);
+
+        //первое сообщение игрока - ключевой кадр, после него зритель видит то же, что и игрок
+        alone::DeltaDecoder decoder;
+        CHECK(decoder.apply(diff->substr(reader.position, length)));
+        reader.position += length;
+        for (size_t i = 0; i != 16 * 16; i++)
+            CHECK(decoder.board()[i] == map.visible(i));
+        CHECK(reader.ok);
+        CHECK(reader.position == diff->size());
+    }
+
+    //клетка за пределами карты отвергается только у того, кто её прислал
+    REQUIRE(second.send(alone::protocol::reveal(99, 0)));
+    pump();
+    auto rejected = second.receive(100);
+    REQUIRE(rejected);
+    CHECK(rejected->at(0) == alone::protocol::Rejected);
+    CHECK(!first.receive(0));
+
+    //ход, присланный прямо перед уходом, приходит вместе с концом потока и всё равно применяется
+    alone::Client watcher;
+    REQUIRE(watcher.connect(path));
+    REQUIRE(watcher.send(alone::protocol::join(9, 42, 16, 40)));
+    pump();
+    REQUIRE(watcher.receive(100));
+    {
+        alone::Client leaver;
+        REQUIRE(leaver.connect(path));
+        REQUIRE(leaver.send(alone::protocol::join(9, 0, 0, 0)));
+        REQUIRE(leaver.send(alone::protocol::reveal(8, 8)));
+    }
+    pump();
+    bool diff = false;
+    while (auto message = watcher.receive(100))
+        diff = diff || message->at(0) == alone::protocol::Diff;
+    CHECK(diff);
+    CHECK(server.games() == 2);
+
+    //медленный читатель отключается, а не копит очередь на сервере
+    alone::Server small(4096);
+    std::string other = path + ".slow";
+    REQUIRE(small.listen(other));
+    alone::Client slow, fast;
+    REQUIRE(slow.connect(other));
+    REQUIRE(fast.connect(other));
+    REQUIRE(slow.send(alone::protocol::join(1, 42, 16, 40)));
+    REQUIRE(fast.send(alone::protocol::join(1, 0, 0, 0)));
+    small.poll(5);
+    small.poll(5);
+    REQUIRE(small.connections() == 2);
+
+    //флаг туда-обратно - каждый раз новое изменение для обоих игроков
+    //посылки небольшими пачками: в буфер сокета клиента влезает всего пара сотен коротких сообщений
+    for (size_t batch = 0; batch != 1000 && small.connections() == 2; batch++) {
+        for (size_t i = 0; i != 100; i++)
+            REQUIRE(fast.send(alone::protocol::flag(0, 0)));
+        small.poll(5);
+        while (fast.receive(0)) {}
+    }
+    CHECK(small.connections() == 1);
+    CHECK(small.games() == 1);
+}
+#endif
\ No newline at end of file
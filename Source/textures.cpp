@@ -0,0 +1,163 @@
+#include "textures.h"
+
+//std
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+alone::TextureManager::~TextureManager() {
+    for (auto& it : _Workers)
+        if (it.joinable())
+            it.join();
+}
+
+void alone::TextureManager::load(std::string config_name) {
+    std::ifstream file(config_name);
+    _Start(file, config_name, nullptr);
+}
+
+void alone::TextureManager::load(const Bundle& bundle, std::string config_name) {
+    auto config = bundle.find(config_name);
+    std::istringstream file(std::string((const char*)config.data(), config.size()));
+    _Start(file, config_name, &bundle);
+}
+
+void alone::TextureManager::_Start(std::istream& config, std::string config_name, const Bundle* bundle) {
+    std::string temp;
+    while (config >> temp) {
+        //одинаковые имена получают один и тот же номер
+        if (_Handles.emplace(temp, (Handle)_Pending.size()).second)
+            _Pending.push_back({ temp });
+    }
+    _Content.resize(_Pending.size());
+
+    //пустой конфиг сразу считается загруженным
+    if (_Pending.empty()) {
+        _Packed = true;
+        return;
+    }
+
+    //картинки лежат рядом с конфигом, но сами файлы могут быть с кастомными именами
+    auto directory = std::filesystem::path(config_name).parent_path().generic_string();
+    if (!directory.empty())
+        directory += '/';
+
+    size_t count = std::min <size_t>(_Pending.size(), std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i != count; i++)
+        _Workers.emplace_back(&TextureManager::_Decode, this, directory, bundle);
+}
+
+void alone::TextureManager::_Decode(std::string directory, const Bundle* bundle) {
+    for (size_t i = _Next++; i < _Pending.size(); i = _Next++) {
+        auto& entry = _Pending[i];
+        if (bundle != nullptr) {
+            auto data = bundle->find(directory + entry.name);
+            entry.loaded = !data.empty() && entry.image.loadFromMemory(data.data(), data.size());
+        } else {
+            entry.loaded = entry.image.loadFromFile(directory + entry.name);
+        }
+
+        if (_Decoded.fetch_add(1) + 1 == _Pending.size())
+            _Pack();
+    }
+}
+
+void alone::TextureManager::_Pack() {
+    //между картинками оставляем зазор, чтобы при сглаживании соседи не залезали друг на друга
+    const unsigned padding = 1;
+
+    std::vector <size_t> order;
+    unsigned area = 0, widest = 0;
+    for (size_t i = 0; i != _Pending.size(); i++) {
+        if (!_Pending[i].loaded)
+            continue;
+
+        auto size = _Pending[i].image.getSize();
+        area += (size.x + padding) * (size.y + padding);
+        widest = std::max(widest, size.x + padding);
+        order.push_back(i);
+    }
+
+    //самые высокие картинки идут первыми, так полки получаются плотнее
+    std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return _Pending[lhs].image.getSize().y > _Pending[rhs].image.getSize().y;
+    });
+
+    unsigned width = 1;
+    while (width < std::max <unsigned>(widest, std::ceil(std::sqrt(area))))
+        width *= 2;
+    width = std::min(width, sf::Texture::getMaximumSize());
+
+    std::vector <sf::Vector2u> places(_Pending.size());
+    unsigned x = 0, y = 0, shelf = 0;
+    for (auto i : order) {
+        auto size = _Pending[i].image.getSize();
+        if (x + size.x > width) {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+
+        places[i] = sf::Vector2u(x, y);
+        x += size.x + padding;
+        shelf = std::max(shelf, size.y + padding);
+    }
+
+    if (!order.empty())
+        _AtlasImage.create(width, y + shelf, sf::Color::Transparent);
+
+    for (auto i : order) {
+        auto& entry = _Pending[i];
+        auto size = entry.image.getSize();
+
+        _AtlasImage.copy(entry.image, places[i].x, places[i].y);
+        _Content[i] = { &_Atlas, sf::IntRect(places[i].x, places[i].y, size.x, size.y) };
+
+        //после упаковки отдельная картинка больше не нужна
+        entry.image = sf::Image();
+    }
+
+    _Packed.store(true, std::memory_order_release);
+}
+
+bool alone::TextureManager::poll() {
+    if (_Ready)
+        return true;
+
+    if (!_Packed.load(std::memory_order_acquire))
+        return false;
+
+    for (auto& it : _Workers)
+        it.join();
+    _Workers.clear();
+    _Pending.clear();
+
+    //текстуру можно создавать только в главном потоке, где живёт контекст окна
+    if (_AtlasImage.getSize().x != 0)
+        _Atlas.loadFromImage(_AtlasImage);
+    _AtlasImage = sf::Image();
+
+    _Ready = true;
+    return true;
+}
+
+float alone::TextureManager::progress() const {
+    if (_Pending.empty())
+        return _Packed ? 1.f : 0.f;
+    return (float)_Decoded / _Pending.size();
+}
+
+const sf::Texture& alone::TextureManager::getAtlas() const {
+    return _Atlas;
+}
+
+alone::TextureManager::Handle alone::TextureManager::find(const std::string& key) const {
+    return _Handles.at(key);
+}
+
+const alone::TextureManager::Region& alone::TextureManager::operator[](Handle handle) const {
+    return _Content[(size_t)handle];
+}
@@ -0,0 +1,138 @@
+#pragma once
+//std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <istream>
+
+//sfml
+#include <SFML/Graphics.hpp>
+
+#include "bundle.h"
+
+namespace alone {
+    /**
+     *  контейнер для управления текстурками
+        картинки декодируются в фоновых потоках и упаковываются в один атлас,
+        а в видеопамять атлас загружается уже в главном потоке
+     */
+    class TextureManager {
+    public:
+        /**
+         *  номер картинки, выдаётся один раз при загрузке конфига
+            по нему картинка ищется простым индексом в массиве, без хеширования строки
+         */
+        enum class Handle : std::uint32_t {};
+
+        /**
+         * где лежит картинка: в каком атласе и в какой его части
+         */
+        struct Region {
+            const sf::Texture* texture = nullptr;
+            sf::IntRect rect;
+        };
+
+        ~TextureManager();
+
+        /**
+         *  запускает фоновую подгрузку картинок из конфига и сразу возвращает управление
+            картинки ищутся в той же папке, где лежит сам конфиг
+         * @param config_name
+         */
+        void load(std::string config_name);
+
+        /**
+         *  то же самое, но и конфиг, и картинки берутся из бандла
+            бандл должен жить, пока идёт загрузка
+         * @param bundle
+         * @param config_name путь конфига внутри бандла
+         */
+        void load(const Bundle& bundle, std::string config_name);
+
+        /**
+         *  вызывается из главного потока каждый кадр
+            как только все картинки декодированы, загружает атлас в видеопамять
+         * @return true, если атлас готов к использованию
+         */
+        bool poll();
+
+        /**
+         * доля уже декодированных картинок, от 0 до 1
+         */
+        float progress() const;
+
+        /**
+         * общий атлас со всеми загруженными картинками
+         */
+        const sf::Texture& getAtlas() const;
+
+        /**
+         *  поиск номера картинки по имени файла из конфига
+            номера известны сразу после load, ещё до окончания загрузки
+         * @param key
+         * @return
+         */
+        Handle find(const std::string& key) const;
+
+        /**
+         *  область картинки внутри атласа
+            у картинок, которые не удалось загрузить, texture равен nullptr
+         * @param handle
+         * @return
+         */
+        const Region& operator[](Handle handle) const;
+
+    private:
+        /**
+         * картинка, которая ждёт упаковки в атлас
+         */
+        struct Entry {
+            std::string name;
+            sf::Image image;
+            bool loaded = false;
+        };
+
+        /**
+         * общая часть обеих загрузок: разбор конфига и запуск фоновых потоков
+         */
+        void _Start(std::istream& config, std::string config_name, const Bundle* bundle);
+
+        /**
+         * работа одного фонового потока, берёт картинки по очереди из общего счётчика
+         */
+        void _Decode(std::string directory, const Bundle* bundle);
+
+        /**
+         *  упаковка всех картинок в один атлас полками
+            вызывается тем потоком, который декодировал последнюю картинку
+         */
+        void _Pack();
+
+        std::vector <Entry> _Pending;
+        std::vector <std::thread> _Workers;
+
+        std::atomic <size_t> _Next = 0;
+        std::atomic <size_t> _Decoded = 0;
+        std::atomic <bool> _Packed = false;
+        bool _Ready = false;
+
+        /**
+         * атлас собирается в оперативной памяти и только потом загружается в видеопамять
+         */
+        sf::Image _AtlasImage;
+        sf::Texture _Atlas;
+
+        /**
+         * области картинок, индекс совпадает с номером картинки
+         */
+        std::vector <Region> _Content;
+
+        /**
+         * строки нужны только один раз, чтобы получить номер
+         */
+        std::unordered_map <std::string, Handle> _Handles;
+    };
+}
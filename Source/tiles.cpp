@@ -0,0 +1,136 @@
+#include "tiles.h"
+
+//std
+#include <algorithm>
+
+namespace {
+    //координаты квадрата в клетках, тексель поля и тайл атласа ищутся по целой части, место внутри тайла - по дробной
+    const char* const Fragment = R"(
+#version 110
+uniform sampler2D board;
+uniform sampler2D atlas;
+uniform vec2 boardTexels;
+uniform vec2 atlasSize;
+uniform vec2 atlasOrigin;
+
+void main() {
+    vec2 cell = floor(gl_TexCoord[0].xy);
+    vec2 inside = gl_TexCoord[0].xy - cell;
+
+    float column = floor(cell.x / 4.0);
+    float lane = cell.x - column * 4.0;
+    vec4 texel = texture2D(board, (vec2(column, cell.y) + 0.5) / boardTexels);
+    float id = lane < 0.5 ? texel.r : lane < 1.5 ? texel.g : lane < 2.5 ? texel.b : texel.a;
+    id = floor(id * 255.0 + 0.5);
+
+    vec2 tile = vec2(mod(id, 4.0), floor(id / 4.0));
+    gl_FragColor = gl_Color * texture2D(atlas, (atlasOrigin + (tile + inside) * 32.0) / atlasSize);
+}
+)";
+}
+
+bool alone::TileRenderer::create(size_t size, const sf::Texture* atlas, sf::Vector2f origin, sf::Vector2f offset, bool shader) {
+    _Size = size;
+    _Atlas = atlas;
+    _Origin = origin;
+    _Offset = offset;
+
+    _Shaded = shader && atlas && sf::Shader::isAvailable() && _Shader.loadFromMemory(Fragment, sf::Shader::Fragment);
+    if (!_Shaded) {
+        _Vertices.resize(4 * size * size);
+        return true;
+    }
+
+    unsigned width = (size + 3) / 4, height = size;
+    if (!_Board.create(width, height)) {
+        _Shaded = false;
+        _Vertices.resize(4 * size * size);
+        return false;
+    }
+    _Pixels.assign(width * 4 * height, (std::uint8_t)Type::Unknown);
+    _Left = _Top = 0;
+    _Right = width;
+    _Bottom = height;
+
+    float edge = size * (float)Tile;
+    _Quad[0] = sf::Vertex(offset, sf::Vector2f(0, 0));
+    _Quad[1] = sf::Vertex(offset + sf::Vector2f(edge, 0), sf::Vector2f(size, 0));
+    _Quad[2] = sf::Vertex(offset + sf::Vector2f(edge, edge), sf::Vector2f(size, size));
+    _Quad[3] = sf::Vertex(offset + sf::Vector2f(0, edge), sf::Vector2f(0, size));
+
+    _Shader.setUniform("board", _Board);
+    _Shader.setUniform("atlas", *atlas);
+    _Shader.setUniform("boardTexels", sf::Glsl::Vec2(width, height));
+    _Shader.setUniform("atlasSize", sf::Glsl::Vec2(atlas->getSize()));
+    _Shader.setUniform("atlasOrigin", sf::Glsl::Vec2(origin));
+    return true;
+}
+
+void alone::TileRenderer::update(const Map& map, bool debug) {
+    if (!_Shaded) {
+        for (size_t i = 0; i != _Size; i++)
+            for (size_t j = 0; j != _Size; j++) {
+                auto quad = &_Vertices[(i + j * _Size) * 4];
+                size_t id = _Tile(map, i + j * _Size, debug);
+                float x = i * (float)Tile, y = j * (float)Tile;
+                float u = _Origin.x + id % 4 * (float)Tile, v = _Origin.y + id / 4 * (float)Tile;
+
+                quad[0] = sf::Vertex(_Offset + sf::Vector2f(x, y), sf::Vector2f(u, v));
+                quad[1] = sf::Vertex(_Offset + sf::Vector2f(x + Tile, y), sf::Vector2f(u + Tile, v));
+                quad[2] = sf::Vertex(_Offset + sf::Vector2f(x + Tile, y + Tile), sf::Vector2f(u + Tile, v + Tile));
+                quad[3] = sf::Vertex(_Offset + sf::Vector2f(x, y + Tile), sf::Vector2f(u, v + Tile));
+            }
+        return;
+    }
+
+    //map._Dirty очищается каждым ходом, а между кадрами ходов может быть несколько,
+    //поэтому сверяем с копией текстуры все клетки: на уровнях игры это не больше 400 байт
+    for (size_t i = 0; i != _Size * _Size; i++)
+        _Set(i % _Size, i / _Size, _Tile(map, i, debug));
+
+    if (_Left >= _Right)
+        return;
+
+    unsigned width = _Right - _Left, height = _Bottom - _Top, row = _Board.getSize().x * 4;
+    _Upload.resize(width * height * 4);
+    for (unsigned y = 0; y != height; y++)
+        std::copy_n(_Pixels.data() + (_Top + y) * row + _Left * 4, width * 4, _Upload.data() + y * width * 4);
+    _Board.update(_Upload.data(), width, height, _Left, _Top);
+
+    _Left = _Top = UINT32_MAX;
+    _Right = _Bottom = 0;
+}
+
+bool alone::TileRenderer::shaded() const {
+    return _Shaded;
+}
+
+void alone::TileRenderer::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (_Shaded) {
+        //текстура не передаётся: тогда координаты квадрата доходят до шейдера как есть, в клетках
+        states.texture = nullptr;
+        states.shader = &_Shader;
+        target.draw(_Quad, states);
+    } else {
+        states.texture = _Atlas;
+        target.draw(_Vertices, states);
+    }
+}
+
+std::uint8_t alone::TileRenderer::_Tile(const Map& map, size_t index, bool debug) {
+    if (debug)
+        return (std::uint8_t)map._Content.data()[index].second;
+    return map.visible(index);
+}
+
+void alone::TileRenderer::_Set(size_t x, size_t y, std::uint8_t tile) {
+    auto& pixel = _Pixels[x + y * _Board.getSize().x * 4];
+    if (pixel == tile)
+        return;
+
+    pixel = tile;
+    _Left = std::min <unsigned>(_Left, x / 4);
+    _Right = std::max <unsigned>(_Right, x / 4 + 1);
+    _Top = std::min <unsigned>(_Top, y);
+    _Bottom = std::max <unsigned>(_Bottom, y + 1);
+}
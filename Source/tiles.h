@@ -0,0 +1,92 @@
+#pragma once
+//std
+#include <vector>
+#include <cstdint>
+
+//sfml
+#include <SFML/Graphics.hpp>
+
+#include "map.h"
+
+namespace alone {
+    /**
+     *  отрисовка поля тайлами из minesweeper.png
+        если шейдеры есть, поле лежит в видеопамяти текстурой по байту на клетку, четыре клетки в одном RGBA текселе,
+        и рисуется одним квадратом: фрагментный шейдер сам находит тайл в атласе для каждого пикселя
+        за кадр в текстуру загружаются только тексели, которые отличаются от её копии в памяти
+        шейдер на GLSL 1.10, поэтому идёт и на программном растеризаторе Mesa (llvmpipe)
+        без шейдеров остаётся старый путь: 4 вершины на клетку
+     */
+    class TileRenderer : public sf::Drawable {
+    public:
+        /**
+         * @param size размер грани поля в клетках
+         * @param atlas общий атлас
+         * @param origin где в атласе лежит картинка с тайлами
+         * @param offset где на экране левый верхний угол поля
+         * @param shader false - всегда рисовать вершинами, например чтобы сравнить оба пути
+         * @return false, если не удалось создать текстуру поля
+         */
+        bool create(size_t size, const sf::Texture* atlas, sf::Vector2f origin, sf::Vector2f offset, bool shader = true);
+
+        /**
+         *  переносит то, что видит игрок, в текстуру или вершины
+            шейдерный путь сверяет все клетки с копией текстуры, поэтому между вызовами может пройти сколько угодно ходов
+         * @param debug показывать содержимое закрытых клеток
+         */
+        void update(const Map& map, bool debug = false);
+
+        /**
+         * рисуется ли поле шейдером
+         */
+        bool shaded() const;
+
+        void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+        /**
+         * размер тайла в пикселях, и на экране, и в атласе
+         */
+        static constexpr unsigned Tile = 32;
+
+    private:
+        /**
+         * номер тайла в атласе для клетки, как в Type
+         */
+        static std::uint8_t _Tile(const Map& map, size_t index, bool debug);
+
+        /**
+         * переписывает байт клетки и расширяет прямоугольник изменённых текселей
+         */
+        void _Set(size_t x, size_t y, std::uint8_t tile);
+
+        size_t _Size = 0;
+        const sf::Texture* _Atlas = nullptr;
+        sf::Vector2f _Origin, _Offset;
+        bool _Shaded = false;
+
+        sf::Shader _Shader;
+        sf::Texture _Board;
+        sf::VertexArray _Quad = sf::VertexArray(sf::Quads, 4);
+
+        /**
+         *  копия текстуры поля: строка - это _Board.getSize().x текселей по 4 байта,
+            поэтому байт клетки (x, y) лежит просто по индексу x + y * ширина строки в байтах
+         */
+        std::vector <std::uint8_t> _Pixels;
+
+        /**
+         * изменённые тексели с прошлой загрузки: [_Left, _Right) x [_Top, _Bottom)
+         */
+        unsigned _Left = 0, _Top = 0, _Right = 0, _Bottom = 0;
+
+        /**
+         * прямоугольник для загрузки, строки которого идут подряд
+         */
+        std::vector <std::uint8_t> _Upload;
+
+        /**
+         * запасной путь без шейдеров
+         */
+        sf::VertexArray _Vertices = sf::VertexArray(sf::Quads);
+    };
+}
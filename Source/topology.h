@@ -0,0 +1,562 @@
+#pragma once
+//std
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <memory_resource>
+#include <chrono>
+#include <limits>
+
+namespace alone {
+    /**
+     *  как клетки поля соединены между собой
+        топология - параметр шаблона Engine, поэтому обход соседей встраивается в генерацию и заливку,
+        и выбор топологии ничего не стоит во время игры
+        у каждой топологии есть:
+            cells() - количество клеток, клетки нумеруются с нуля
+            MaxNeighbours - сколько соседей может быть у клетки
+            neighbours(index, visit) - вызывает visit(сосед) для каждого соседа
+     */
+    namespace topology {
+        /**
+         * обычное поле, клетка (x, y) - это x + y * width, у клетки до 8 соседей
+         */
+        class Square {
+        public:
+            static constexpr size_t MaxNeighbours = 8;
+
+            Square(size_t width, size_t height) : _Width(width), _Height(height) {}
+
+            size_t cells() const {
+                return _Width * _Height;
+            }
+
+            size_t width() const {
+                return _Width;
+            }
+
+            size_t height() const {
+                return _Height;
+            }
+
+            template <class _Visit>
+            void neighbours(size_t index, _Visit&& visit) const {
+                size_t x = index % _Width, y = index / _Width;
+                for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < _Height; j++)
+                    for (size_t i = x == 0 ? 0 : x - 1; i <= x + 1 && i < _Width; i++)
+                        if (i != x || j != y)
+                            visit(i + j * _Width);
+            }
+
+        private:
+            size_t _Width, _Height;
+        };
+
+        /**
+         * поле, склеенное по краям в тор: у каждой клетки ровно 8 соседей
+         */
+        class Torus {
+        public:
+            static constexpr size_t MaxNeighbours = 8;
+
+            Torus(size_t width, size_t height) : _Width(width), _Height(height) {}
+
+            size_t cells() const {
+                return _Width * _Height;
+            }
+
+            template <class _Visit>
+            void neighbours(size_t index, _Visit&& visit) const {
+                size_t x = index % _Width, y = index / _Width;
+                for (size_t dy = 0; dy != 3; dy++)
+                    for (size_t dx = 0; dx != 3; dx++)
+                        if (dx != 1 || dy != 1)
+                            visit((x + _Width + dx - 1) % _Width + (y + _Height + dy - 1) % _Height * _Width);
+            }
+
+        private:
+            size_t _Width, _Height;
+        };
+
+        /**
+         *  шестиугольники, нечётные строки сдвинуты на полклетки вправо, у клетки до 6 соседей
+            клетка (x, y) - это x + y * width
+         */
+        class Hex {
+        public:
+            static constexpr size_t MaxNeighbours = 6;
+
+            Hex(size_t width, size_t height) : _Width(width), _Height(height) {}
+
+            size_t cells() const {
+                return _Width * _Height;
+            }
+
+            template <class _Visit>
+            void neighbours(size_t index, _Visit&& visit) const {
+                std::ptrdiff_t x = index % _Width, y = index / _Width;
+                //сдвиг соседних строк зависит от чётности своей строки
+                std::ptrdiff_t shift = y % 2;
+                const std::pair <std::ptrdiff_t, std::ptrdiff_t> offsets[6] = {
+                    { shift - 1, -1 }, { shift, -1 },
+                    { -1, 0 }, { 1, 0 },
+                    { shift - 1, 1 }, { shift, 1 }
+                };
+                for (auto [dx, dy] : offsets) {
+                    std::ptrdiff_t i = x + dx, j = y + dy;
+                    if (i >= 0 && j >= 0 && i < (std::ptrdiff_t)_Width && j < (std::ptrdiff_t)_Height)
+                        visit(i + j * _Width);
+                }
+            }
+
+        private:
+            size_t _Width, _Height;
+        };
+
+        /**
+         *  трёхмерное поле, клетка (x, y, z) - это x + (y + z * height) * width, у клетки до 26 соседей
+         */
+        class Cube {
+        public:
+            static constexpr size_t MaxNeighbours = 26;
+
+            Cube(size_t width, size_t height, size_t depth) : _Width(width), _Height(height), _Depth(depth) {}
+
+            size_t cells() const {
+                return _Width * _Height * _Depth;
+            }
+
+            template <class _Visit>
+            void neighbours(size_t index, _Visit&& visit) const {
+                size_t x = index % _Width, y = index / _Width % _Height, z = index / (_Width * _Height);
+                for (size_t k = z == 0 ? 0 : z - 1; k <= z + 1 && k < _Depth; k++)
+                    for (size_t j = y == 0 ? 0 : y - 1; j <= y + 1 && j < _Height; j++)
+                        for (size_t i = x == 0 ? 0 : x - 1; i <= x + 1 && i < _Width; i++)
+                            if (i != x || j != y || k != z)
+                                visit(i + (j + k * _Height) * _Width);
+            }
+
+        private:
+            size_t _Width, _Height, _Depth;
+        };
+    }
+
+    /**
+     *  общее ядро карты на любой топологии: расстановка бомб, заливка, флаги, аккорд и счётчики
+        на нём построены и Map (квадрат), и Field (остальные топологии), поэтому правила игры в одном месте
+        клетки хранит наследник (_Derived), ядро обращается к ним через:
+            char& _State(index) - n, r или f
+            std::uint8_t _Around(index) - бомб вокруг или Mine, ленивые числа считаются здесь
+            bool _Mine(index) - в клетке бомба, без подсчёта чисел
+            bool _OpenArea(index) - открыть готовую область пустой клетки целиком через _Open, false - обычная заливка
+            void _Flagged(index, delta) - флаг поставлен или снят
+     */
+    template <class _Derived, class _Topology>
+    class Engine {
+    public:
+        /**
+         * _Around для клетки с бомбой
+         */
+        static constexpr std::uint8_t Mine = UINT8_MAX;
+
+        /**
+         * сколько клеток advance открывает между проверками часов
+         */
+        static constexpr size_t AdvanceStep = 256;
+
+        /**
+         *  счётчики ведутся по ходу игры, поэтому все проверки ниже за O(1) на карте любого размера
+            во время заливки по частям они отстают от итога хода, см. Map::revealSliced
+            открытые клетки без бомб
+         */
+        size_t revealed() const {
+            return _RevealedSafe;
+        }
+
+        /**
+         * флаги, стоящие на бомбах
+         */
+        size_t correctFlags() const {
+            return _CorrectFlags;
+        }
+
+        /**
+         * сколько бомб осталось найти по мнению игрока: бомбы минус все флаги, может быть меньше нуля
+         */
+        std::ptrdiff_t remaining() const {
+            return (std::ptrdiff_t)_Bombs - (std::ptrdiff_t)_FlagCount;
+        }
+
+        /**
+         * открыты все клетки без бомб, флаги для победы не нужны
+         */
+        bool won() const {
+            size_t cells = _Shape.cells();
+            return _Exploded == 0 && _Bombs < cells && _RevealedSafe == cells - _Bombs;
+        }
+
+        /**
+         * открыта бомба
+         */
+        bool lost() const {
+            return _Exploded != 0;
+        }
+
+        /**
+         *  продолжает заливку, пока не выйдет время; нулевой бюджет доделывает её целиком
+         * @return true, если заливка закончена
+         */
+        bool advance(std::chrono::microseconds budget) {
+            if (budget.count() <= 0) {
+                settle();
+                return true;
+            }
+
+            //часы спрашиваются не на каждой клетке, а раз в AdvanceStep клеток
+            auto deadline = std::chrono::steady_clock::now() + budget;
+            while (pending() && std::chrono::steady_clock::now() < deadline)
+                _Flood(AdvanceStep);
+            return !pending();
+        }
+
+        /**
+         * доделывает заливку целиком
+         */
+        void settle() {
+            if (pending())
+                _Flood();
+        }
+
+        /**
+         * заливка ещё идёт
+         */
+        bool pending() const {
+            return _Head != _Queue.size();
+        }
+
+        const _Topology& topology() const {
+            return _Shape;
+        }
+
+        /**
+         * кол-во бомб на карте
+         */
+        size_t _Bombs = 0;
+
+        /**
+         *  номера клеток, которые изменились за последний ход
+            очищается в начале каждого хода
+         */
+        std::pmr::vector <size_t> _Dirty;
+
+        /**
+         *  ставит клетке состояние напрямую, с учётом счётчиков, и добавляет её в _Dirty
+            нужно истории ходов, _Dirty перед этим очищает вызывающий
+         */
+        void _Restore(size_t index, char state) {
+            auto& cell = _Self()._State(index);
+            bool bomb = _Self()._Mine(index);
+
+            auto count = [&](int delta) {
+                if (cell == 'r')
+                    (bomb ? _Exploded : _RevealedSafe) += delta;
+                else if (cell == 'f') {
+                    _Self()._Flagged(index, delta);
+                    _FlagCount += delta;
+                    _CorrectFlags += bomb ? delta : 0;
+                }
+            };
+
+            //сначала убираем клетку из счётчиков по старому состоянию, потом добавляем по новому
+            count(-1);
+            cell = state;
+            count(1);
+            if (state == 'r')
+                _Self()._Around(index);
+            _Dirty.push_back(index);
+        }
+
+    protected:
+        explicit Engine(_Topology topology, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : _Dirty(resource), _Shape(topology), _Unfilled(resource), _Queue(resource) {}
+
+        /**
+         *  открывает закрытую клетку; если она пустая, то открываются и соседи
+         * @return true, если в клетке бомба
+         */
+        bool _Reveal(size_t index) {
+            settle();
+            _Dirty.clear();
+            if (_Self()._State(index) != 'n')
+                return false;
+
+            _Queue.assign(1, index);
+            _Head = 0;
+            _Flood();
+            return _Self()._Mine(index);
+        }
+
+        /**
+         * то же, но сразу открывается только сама клетка, остальное - в advance
+         */
+        bool _RevealSliced(size_t index) {
+            settle();
+            _Dirty.clear();
+            if (_Self()._State(index) != 'n')
+                return false;
+
+            //сама клетка открывается сразу, поэтому взрыв и звук нажатия известны в этом же кадре
+            _Queue.assign(1, index);
+            _Head = 0;
+            _Flood(1);
+            return _Self()._Mine(index);
+        }
+
+        /**
+         * @return true, если флаг поставлен
+         */
+        bool _Flag(size_t index) {
+            settle();
+            _Dirty.clear();
+            auto& state = _Self()._State(index);
+            if (state == 'r')
+                return false;
+
+            state = state == 'f' ? 'n' : 'f';
+            _Dirty.push_back(index);
+
+            int delta = state == 'f' ? 1 : -1;
+            _Self()._Flagged(index, delta);
+            _FlagCount += delta;
+            if (_Self()._Mine(index))
+                _CorrectFlags += delta;
+            return state == 'f';
+        }
+
+        /**
+         *  если вокруг открытого числа стоит ровно столько флагов, сколько это число,
+            все остальные закрытые соседи открываются одной заливкой
+         * @return true, если среди открытых соседей оказалась бомба
+         */
+        bool _Chord(size_t index) {
+            settle();
+            _Dirty.clear();
+            if (_Self()._State(index) != 'r')
+                return false;
+            auto around = _Self()._Around(index);
+            if (around == Mine || around == 0)
+                return false;
+
+            size_t flags = 0;
+            _Shape.neighbours(index, [&](size_t neighbour) { flags += _Self()._State(neighbour) == 'f'; });
+            if (flags != around)
+                return false;
+
+            //заливка не идёт дальше чисел, поэтому бомба может открыться только среди самих соседей
+            bool bomb = false;
+            _Queue.clear();
+            _Head = 0;
+            _Shape.neighbours(index, [&](size_t neighbour) {
+                if (_Self()._State(neighbour) == 'n') {
+                    _Queue.push_back(neighbour);
+                    bomb |= _Self()._Mine(neighbour);
+                }
+            });
+            _Flood();
+            return bomb;
+        }
+
+        /**
+         *  все клетки, кроме first, в _Unfilled и частичное перемешивание: первые _Bombs из них - бомбы
+            остаток от деления, а не uniform_int_distribution, чтобы карта по зерну совпадала на всех компиляторах
+         * @return сколько бомб поместилось
+         */
+        size_t _Scatter(size_t first, std::mt19937_64& rng) {
+            size_t cells = _Shape.cells();
+            _Unfilled.clear();
+            for (size_t i = 0; i != cells; i++)
+                if (i != first)
+                    _Unfilled.push_back(i);
+
+            size_t placed = std::min(_Bombs, _Unfilled.size());
+            for (size_t i = 0; i != placed; i++) {
+                size_t pos = i + rng() % (_Unfilled.size() - i);
+                std::swap(_Unfilled[i], _Unfilled[pos]);
+            }
+            return placed;
+        }
+
+        /**
+         * сбрасывает счётчики и недоделанную заливку, вызывается при генерации и изменении размера
+         */
+        void _Reset() {
+            _Queue.clear();
+            _Head = 0;
+            _RevealedSafe = _CorrectFlags = _FlagCount = _Exploded = 0;
+        }
+
+        /**
+         * открывает одну закрытую клетку и учитывает её в счётчиках
+         */
+        std::uint8_t _Open(size_t index) {
+            _Self()._State(index) = 'r';
+            _Dirty.push_back(index);
+            auto around = _Self()._Around(index);
+            if (around == Mine)
+                _Exploded++;
+            else
+                _RevealedSafe++;
+            return around;
+        }
+
+        /**
+         *  заливка от всех клеток, уже лежащих в _Queue, но не больше limit открытых клеток
+            очередь, а не стек: открытая часть растёт от нажатия во все стороны, как волна
+            готовые области открываются целиком только без ограничения, иначе заливка шла бы не волной, а скачками
+            клетки с флагами заливка не трогает
+         */
+        void _Flood(size_t limit = std::numeric_limits <size_t>::max()) {
+            bool whole = limit == std::numeric_limits <size_t>::max();
+            while (_Head != _Queue.size() && limit != 0) {
+                size_t index = _Queue[_Head++];
+                if (_Self()._State(index) != 'n')
+                    continue;
+                limit--;
+
+                if (whole && _Self()._OpenArea(index))
+                    continue;
+
+                //дальше идём только от пустых клеток
+                if (_Open(index) != 0)
+                    continue;
+                _Shape.neighbours(index, [&](size_t neighbour) {
+                    if (_Self()._State(neighbour) == 'n')
+                        _Queue.push_back(neighbour);
+                });
+            }
+
+            //пройденное начало очереди выкидывается, чтобы долгая заливка не держала все клетки сразу
+            if (_Head == _Queue.size()) {
+                _Queue.clear();
+                _Head = 0;
+            } else if (_Head > 4096 && _Head * 2 > _Queue.size()) {
+                _Queue.erase(_Queue.begin(), _Queue.begin() + _Head);
+                _Head = 0;
+            }
+        }
+
+        _Topology _Shape;
+
+        /**
+         * рабочий массив генерации, не пересоздаётся между генерациями
+         */
+        std::pmr::vector <size_t> _Unfilled;
+
+    private:
+        _Derived& _Self() {
+            return static_cast <_Derived&>(*this);
+        }
+
+        /**
+         * очередь заливки и её начало, всё до _Head уже обработано
+         */
+        std::pmr::vector <size_t> _Queue;
+        size_t _Head = 0;
+
+        size_t _RevealedSafe = 0;
+        size_t _CorrectFlags = 0;
+        size_t _FlagCount = 0;
+
+        /**
+         * открытые бомбы; не флаг, а число, потому что аккорд может открыть сразу несколько, а история - закрыть их обратно
+         */
+        size_t _Exploded = 0;
+    };
+
+    /**
+     *  карта на любой топологии поверх Engine
+        числа хранятся количеством бомб вокруг, а не Type, потому что у куба их может быть до 26
+        состояния клеток те же, что у Map: n - закрыта, r - открыта, f - флаг
+     */
+    template <class _Topology>
+    class Field : public Engine <Field <_Topology>, _Topology> {
+        using Base = Engine <Field <_Topology>, _Topology>;
+        friend Base;
+
+    public:
+        explicit Field(_Topology topology) : Base(topology), _Counts(topology.cells(), 0), _States(topology.cells(), 'n') {}
+
+        /**
+         *  та же расстановка, что и у Map::generate, поэтому квадратная топология с тем же генератором даёт ту же карту
+         */
+        void generate(size_t bombs, size_t first, std::mt19937_64& rng) {
+            std::fill(_Counts.begin(), _Counts.end(), 0);
+            std::fill(_States.begin(), _States.end(), 'n');
+            this->_Reset();
+            this->_Bombs = bombs;
+
+            size_t placed = this->_Scatter(first, rng);
+            for (size_t i = 0; i != placed; i++)
+                _Counts[this->_Unfilled[i]] = Base::Mine;
+
+            //числа от бомб, а не от клеток: O(бомбы * соседи)
+            for (size_t i = 0; i != placed; i++)
+                this->_Shape.neighbours(this->_Unfilled[i], [&](size_t neighbour) {
+                    if (_Counts[neighbour] != Base::Mine)
+                        _Counts[neighbour]++;
+                });
+        }
+
+        bool reveal(size_t index) {
+            return this->_Reveal(index);
+        }
+
+        bool flag(size_t index) {
+            return this->_Flag(index);
+        }
+
+        bool chord(size_t index) {
+            return this->_Chord(index);
+        }
+
+        /**
+         * количество бомб вокруг клетки или Mine
+         */
+        std::uint8_t around(size_t index) const {
+            return _Counts[index];
+        }
+
+        char state(size_t index) const {
+            return _States[index];
+        }
+
+        size_t cells() const {
+            return this->_Shape.cells();
+        }
+
+    private:
+        char& _State(size_t index) {
+            return _States[index];
+        }
+
+        std::uint8_t _Around(size_t index) const {
+            return _Counts[index];
+        }
+
+        bool _Mine(size_t index) const {
+            return _Counts[index] == Base::Mine;
+        }
+
+        bool _OpenArea(size_t) {
+            return false;
+        }
+
+        void _Flagged(size_t, int) {}
+
+        std::vector <std::uint8_t> _Counts;
+        std::vector <char> _States;
+    };
+}